@@ -0,0 +1,251 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <toml.hpp>
+#include <vector>
+
+#include "thread_pool.h"
+#include "toml_number.h"
+
+namespace {
+
+struct BatchLeague {
+    std::string name;
+    LeagueConfig config;
+    bool hasTimeBudget;
+};
+
+struct BatchResult {
+    // "ok", "timeout" if the league found no schedule in its time budget,
+    // or "failed".
+    std::string status;
+    std::string error;
+    int bestScore;
+    int numSchedules;
+    long attempts;
+    double seconds;
+};
+
+BatchLeague readLeague(const toml::value& league, const LeagueConfig& d) {
+    BatchLeague batchLeague;
+    LeagueConfig& config = batchLeague.config;
+
+    config.dataPath = toml::find<std::string>(league, "DATA_DIR");
+    batchLeague.name =
+        toml::find_or<std::string>(league, "NAME", config.dataPath);
+    config.outputPath = toml::find_or<std::string>(
+        league, "OUTPUT_DIR", d.outputPath + "/" + batchLeague.name
+    );
+
+    config.leagueId =
+        toml::find_or<std::string>(league, "LEAGUE_ID", d.leagueId);
+    config.update = toml::find_or<bool>(league, "UPDATE_DATA", d.update);
+    config.weeks = toml::find_or<int>(league, "NUM_WEEKS", d.weeks);
+    config.weeksBetweenMatchups = toml::find_or<int>(
+        league, "NUM_WEEKS_BETWEEN_MATCHUPS", d.weeksBetweenMatchups
+    );
+    config.numSchedules =
+        toml::find_or<int>(league, "NUM_SCHEDULES", d.numSchedules);
+    config.searchThreads =
+        toml::find_or<int>(league, "NUM_SEARCH_THREADS", d.searchThreads);
+    config.heuristics = SearchHeuristics{
+        toml::find_or<bool>(
+            league, "MRV_ORDERING", d.heuristics.minimumRemainingValues
+        ),
+        toml::find_or<bool>(
+            league, "LCV_ORDERING", d.heuristics.leastConstrainingValue
+        ),
+        toml::find_or<bool>(league, "LUBY_RESTARTS", d.heuristics.lubyRestarts),
+        toml::find_or<int>(league, "RESTART_UNIT", d.heuristics.restartUnit)
+    };
+    config.matchingEngine =
+        toml::find_or<bool>(league, "MATCHING_ENGINE", d.matchingEngine);
+    config.nogoodCacheSize =
+        toml::find_or<int>(league, "NOGOOD_CACHE_SIZE", d.nogoodCacheSize);
+    config.criteriaBias =
+        toml::find_or<double>(league, "CRITERIA_BIAS", d.criteriaBias);
+    config.logoPath =
+        toml::find_or<std::string>(league, "LOGO_PATH", d.logoPath);
+    config.title =
+        toml::find_or<std::string>(league, "SCHEDULE_TITLE", d.title);
+
+    batchLeague.hasTimeBudget = league.contains("TIME_BUDGET_SECONDS");
+    config.timeBudget =
+        findNumberOr(league, "TIME_BUDGET_SECONDS", d.timeBudget);
+
+    return batchLeague;
+}
+
+BatchResult runLeague(const BatchLeague& league) {
+    auto start = std::chrono::steady_clock::now();
+    BatchResult result{"failed", "", 0, 0, 0, 0};
+
+    try {
+        LeagueData data = loadLeagueData(league.config);
+        LeagueResult leagueResult =
+            scheduleLeague(league.config, data, nullptr);
+
+        result.status = leagueResult.schedules.empty() &&
+                                league.config.numSchedules > 0
+                            ? "timeout"
+                            : "ok";
+        result.numSchedules = leagueResult.schedules.size();
+        result.attempts = leagueResult.stats.attempts;
+        if (!leagueResult.schedules.empty()) {
+            result.bestScore = leagueResult.schedules[0].score;
+        }
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    result.seconds = seconds.count();
+    return result;
+}
+
+// Cuts a league's time budget off at the batch's deadline. Returns false
+// if the deadline has already passed.
+bool fitToDeadline(
+    LeagueConfig& config,
+    std::chrono::steady_clock::time_point deadline
+) {
+    std::chrono::duration<double> timeLeft =
+        deadline - std::chrono::steady_clock::now();
+    if (timeLeft.count() <= 0) {
+        return false;
+    }
+
+    config.timeBudget = config.timeBudget > 0
+                            ? std::min(config.timeBudget, timeLeft.count())
+                            : timeLeft.count();
+    return true;
+}
+
+std::string quoteCsv(const std::string& value) {
+    std::string quoted = "\"";
+    for (char c : value) {
+        quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+}  // namespace
+
+void runBatch(const std::string& manifestPath, const LeagueConfig& defaults) {
+    const auto manifest = toml::parse(manifestPath);
+    const toml::value batchConfig = manifest.contains("BATCH")
+                                        ? toml::find(manifest, "BATCH")
+                                        : toml::value(toml::table{});
+    const int cores = std::thread::hardware_concurrency();
+    const int numThreads =
+        std::max(toml::find_or<int>(batchConfig, "NUM_THREADS", cores), 1);
+    const double timeBudget =
+        findNumberOr(batchConfig, "TIME_BUDGET_SECONDS", 0);
+    const std::string summaryPath = toml::find_or<std::string>(
+        batchConfig, "SUMMARY_PATH", "batch-summary.csv"
+    );
+
+    std::vector<BatchLeague> leagues;
+    for (const auto& league : toml::find<toml::array>(manifest, "LEAGUE")) {
+        leagues.push_back(readLeague(league, defaults));
+    }
+
+    // Leagues run at the same time, and each one empties its output
+    // directory first.
+    for (int i = 0; i < leagues.size(); i++) {
+        for (int j = 0; j < i; j++) {
+            if (outputPathsOverlap(
+                    leagues[i].config.outputPath, leagues[j].config.outputPath
+                )) {
+                throw std::invalid_argument(
+                    "Error reading batch: leagues " + leagues[j].name +
+                    " and " + leagues[i].name +
+                    " write to the same output directory."
+                );
+            }
+        }
+    }
+
+    // Leagues without their own budget share the pool's thread time left
+    // over by the leagues with one. A league that waits for a thread
+    // would overrun the batch with its full share, so every league is
+    // also cut off at the batch's deadline when it starts.
+    const auto deadline =
+        std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(timeBudget)
+        );
+    if (timeBudget > 0) {
+        double threadTime = timeBudget * numThreads;
+        int sharing = 0;
+        for (const auto& league : leagues) {
+            if (!league.hasTimeBudget) {
+                ++sharing;
+            } else if (league.config.timeBudget > 0) {
+                threadTime -= std::min(league.config.timeBudget, timeBudget);
+            } else {
+                threadTime -= timeBudget;
+            }
+        }
+
+        // A budget of 0 means no limit, so every share gets at least a
+        // second, or the whole budget if that is shorter.
+        double fairShare = std::clamp(
+            sharing > 0 ? threadTime / sharing : 0.0,
+            std::min(1.0, timeBudget),
+            timeBudget
+        );
+        for (auto& league : leagues) {
+            if (!league.hasTimeBudget) {
+                league.config.timeBudget = fairShare;
+            }
+        }
+    }
+
+    std::vector<BatchResult> results(leagues.size());
+    {
+        ThreadPool pool(numThreads);
+        for (int i = 0; i < leagues.size(); i++) {
+            pool.submit(0, [&leagues, &results, i, timeBudget, deadline] {
+                if (timeBudget > 0 &&
+                    !fitToDeadline(leagues[i].config, deadline)) {
+                    results[i] = BatchResult{
+                        "timeout",
+                        "The batch ran out of time before the league started.",
+                        0,
+                        0,
+                        0,
+                        0
+                    };
+                    return;
+                }
+                results[i] = runLeague(leagues[i]);
+            });
+        }
+        pool.wait();
+    }
+
+    std::ofstream summary(summaryPath);
+    summary << "League,Status,Best Score,Schedules,Attempts,Seconds,Error\n";
+    for (int i = 0; i < leagues.size(); i++) {
+        const BatchResult& result = results[i];
+        summary << quoteCsv(leagues[i].name) << "," << result.status << ",";
+        // A league without schedules has no best score.
+        if (result.numSchedules > 0) {
+            summary << result.bestScore;
+        }
+        summary << "," << result.numSchedules << "," << result.attempts
+                << "," << result.seconds << "," << quoteCsv(result.error)
+                << "\n";
+    }
+    summary.close();
+
+    std::cout << "Scheduled " << leagues.size() << " leagues; summary written "
+              << "to " << summaryPath << std::endl;
+}
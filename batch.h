@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "league.h"
+
+// Schedules every league listed in a TOML manifest concurrently on a
+// bounded thread pool, then writes a CSV summary of each league's best
+// score and runtime. Settings missing from a league fall back to
+// `defaults`. Leagues must write to separate output directories.
+//
+// [BATCH]
+// NUM_THREADS = 8            # defaults to the number of cores
+// TIME_BUDGET_SECONDS = 600  # wall-clock budget for the whole batch
+// SUMMARY_PATH = "batch-summary.csv"
+//
+// [[LEAGUE]]
+// NAME = "league-a"
+// DATA_DIR = "leagues/a/data"
+// OUTPUT_DIR = "leagues/a/output"  # defaults to output/<NAME>
+// # Plus any [LEAGUE], [SCHEDULE] or [OUTPUT] setting from config.toml.
+void runBatch(const std::string& manifestPath, const LeagueConfig& defaults);
@@ -0,0 +1,442 @@
+#include "counter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+const ScheduleCount maxCount = ~ScheduleCount(0);
+
+ScheduleCount addCounts(ScheduleCount a, ScheduleCount b) {
+    return a > maxCount - b ? maxCount : a + b;
+}
+
+}  // namespace
+
+std::string formatScheduleCount(ScheduleCount count) {
+    if (count == 0) {
+        return "0";
+    }
+
+    std::string digits;
+    for (; count > 0; count /= 10) {
+        digits += char('0' + int(count % 10));
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+ScheduleCounter::ScheduleCounter(
+    int weeks_,
+    int numEntities_,
+    int weeksBetweenMatchups_,
+    std::vector<int> owedMatchups_,
+    std::vector<int> pinnedSchedule_
+)
+    : weeks(weeks_),
+      numEntities(numEntities_),
+      weeksBetweenMatchups(weeksBetweenMatchups_),
+      owedMatchups(owedMatchups_),
+      pinnedSchedule(pinnedSchedule_),
+      pinnedWeeks(weeks_, false),
+      validator(
+          weeks_,
+          numEntities_,
+          weeksBetweenMatchups_,
+          owedMatchups_,
+          pinnedSchedule_
+      ),
+      numSymmetryClasses(0),
+      maxStates(0),
+      exceeded(false),
+      signatures(numEntities_),
+      order(numEntities_),
+      labels(numEntities_) {
+    for (int i = 0; i < pinnedSchedule.size(); i++) {
+        if (pinnedSchedule[i] >= 0) {
+            pinnedWeeks[i / numEntities] = true;
+        }
+    }
+
+    findSymmetries();
+}
+
+// Groups the entities into classes of interchangeable entities. Two
+// entities are interchangeable when swapping them maps the owed matchups
+// and the pinned weeks onto themselves. Any reordering within a class is
+// then a series of such swaps, so it does not change the number of ways
+// to finish a schedule either.
+void ScheduleCounter::findSymmetries() {
+    entityClasses.resize(numEntities);
+    std::iota(entityClasses.begin(), entityClasses.end(), 0);
+
+    for (int entity = 0; entity < numEntities; entity++) {
+        if (entityClasses[entity] != entity) continue;
+
+        for (int other = entity + 1; other < numEntities; other++) {
+            if (entityClasses[other] == other && isSymmetric(entity, other)) {
+                entityClasses[other] = entity;
+            }
+        }
+    }
+
+    numSymmetryClasses = 0;
+    for (int entity = 0; entity < numEntities; entity++) {
+        if (entityClasses[entity] == entity) {
+            ++numSymmetryClasses;
+        }
+    }
+
+    classMembers.resize(numEntities);
+    std::iota(classMembers.begin(), classMembers.end(), 0);
+    std::stable_sort(
+        classMembers.begin(),
+        classMembers.end(),
+        [this](int a, int b) { return entityClasses[a] < entityClasses[b]; }
+    );
+}
+
+bool ScheduleCounter::isSymmetric(int entity, int other) const {
+    auto swap = [entity, other](int e) {
+        return e == entity ? other : e == other ? entity : e;
+    };
+
+    for (int e = 0; e < numEntities; e++) {
+        if (e == entity || e == other) continue;
+
+        if (owedMatchups[entity * numEntities + e] !=
+            owedMatchups[other * numEntities + e]) {
+            return false;
+        }
+    }
+
+    for (int week = 1; week <= weeks; week++) {
+        const int* pinned = &pinnedSchedule[(week - 1) * numEntities];
+        for (int e = 0; e < numEntities; e++) {
+            int opponent = pinned[swap(e)];
+            if ((opponent < 0 ? -1 : swap(opponent)) != pinned[e]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Counts every valid schedule, memoizing at most `maxStates_` states.
+// Returns false, leaving `result` unset, if that is not enough.
+bool ScheduleCounter::count(long maxStates_, ScheduleCount& result) {
+    counts.clear();
+    maxStates = maxStates_;
+    exceeded = false;
+
+    reset();
+    ScheduleCount total = countWeeks(1);
+    if (exceeded) {
+        counts.clear();
+        return false;
+    }
+
+    result = total;
+    return true;
+}
+
+// Estimates the number of valid schedules from `probes` random walks
+// down the search tree (Knuth's estimator). Each walk picks the lowest
+// unscheduled entity's opponent uniformly at random, and scores the
+// product of the number of choices it had at every step if it ends in a
+// valid schedule. `relativeError` is set to the standard error of the
+// estimate divided by the estimate.
+double ScheduleCounter::estimate(
+    long probes,
+    std::mt19937& rng,
+    double& relativeError
+) {
+    std::vector<int> candidates(numEntities);
+    double sum = 0;
+    double sumOfSquares = 0;
+
+    for (long probe = 0; probe < probes; probe++) {
+        reset();
+        double weight = 1;
+
+        for (int week = nextWeek(1); week <= weeks && weight > 0;) {
+            int entity = nextEntity(week);
+            if (entity < 0) {
+                week = nextWeek(week + 1);
+                continue;
+            }
+
+            int numCandidates = 0;
+            for (int opponent = entity + 1; opponent < numEntities;
+                 opponent++) {
+                if (canPlay(week, entity, opponent)) {
+                    candidates[numCandidates++] = opponent;
+                }
+            }
+
+            weight *= numCandidates;
+            if (numCandidates > 0) {
+                placeMatchup(week, entity, candidates[rng() % numCandidates]);
+            }
+        }
+
+        if (weight > 0 && isValid()) {
+            sum += weight;
+            sumOfSquares += weight * weight;
+        }
+    }
+
+    double mean = probes > 0 ? sum / probes : 0;
+    if (mean <= 0) {
+        relativeError = 0;
+        return 0;
+    }
+
+    double variance = std::max(sumOfSquares / probes - mean * mean, 0.0);
+    relativeError = std::sqrt(variance / probes) / mean;
+    return mean;
+}
+
+// Calls `visit` with every valid schedule. States that `count` found to
+// have no valid completion are skipped, so the work is proportional to
+// the number of schedules; call `count` first.
+void ScheduleCounter::enumerate(
+    const std::function<void(const std::vector<int>&)>& visit
+) {
+    reset();
+    enumerateWeeks(1, visit);
+}
+
+// The number of distinct states memoized by the last call to `count`.
+long ScheduleCounter::getNumStates() const { return counts.size(); }
+
+int ScheduleCounter::getNumSymmetryClasses() const {
+    return numSymmetryClasses;
+}
+
+// Starts over from the pinned matchups, placed the same way as
+// `Scheduler::insertScheduleConstraints` places them.
+void ScheduleCounter::reset() {
+    schedule.assign(weeks * numEntities, -1);
+    remaining = owedMatchups;
+    for (int i = 0; i < pinnedSchedule.size(); i++) {
+        int entity = i % numEntities;
+        int opponent = pinnedSchedule[i];
+        if (opponent > entity) {
+            placeMatchup(i / numEntities + 1, entity, opponent);
+        }
+    }
+}
+
+// Builds a key for the state before `week` that is the same for every
+// state obtained by reordering interchangeable entities. Entities are
+// relabeled within their class in order of a signature that such a
+// reordering does not change. Entities with equal signatures are not
+// always interchangeable in the current state, so two equivalent states
+// can still get different keys, but two states with the same key always
+// have the same number of completions.
+std::string ScheduleCounter::getStateKey(int week) {
+    int startWeek = std::max(week - weeksBetweenMatchups, 1);
+
+    for (int entity = 0; entity < numEntities; entity++) {
+        std::vector<int>& signature = signatures[entity];
+        signature.clear();
+
+        for (int other = 0; other < numEntities; other++) {
+            if (other == entity) continue;
+
+            signature.push_back(
+                entityClasses[other] * 256 +
+                remaining[entity * numEntities + other]
+            );
+        }
+        std::sort(signature.begin(), signature.end());
+
+        for (int w = startWeek; w < week; w++) {
+            int opponent = schedule[(w - 1) * numEntities + entity];
+            signature.push_back(opponent < 0 ? -1 : entityClasses[opponent]);
+        }
+    }
+
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        if (entityClasses[a] != entityClasses[b]) {
+            return entityClasses[a] < entityClasses[b];
+        }
+        if (signatures[a] != signatures[b]) {
+            return signatures[a] < signatures[b];
+        }
+        return a < b;
+    });
+
+    // Hand out each class's own labels in signature order.
+    for (int i = 0; i < numEntities; i++) {
+        labels[order[i]] = classMembers[i];
+    }
+
+    std::string key(1, char(week));
+    key.resize(1 + numEntities * (numEntities - 1) / 2);
+    for (int entity = 0; entity < numEntities; entity++) {
+        for (int other = entity + 1; other < numEntities; other++) {
+            int a = std::min(labels[entity], labels[other]);
+            int b = std::max(labels[entity], labels[other]);
+            int pair = a * numEntities - a * (a + 1) / 2 + b - a - 1;
+            key[1 + pair] = char(remaining[entity * numEntities + other]);
+        }
+    }
+
+    std::string window((week - startWeek) * numEntities, char(-1));
+    for (int w = startWeek; w < week; w++) {
+        for (int entity = 0; entity < numEntities; entity++) {
+            int opponent = schedule[(w - 1) * numEntities + entity];
+            window[(w - startWeek) * numEntities + labels[entity]] =
+                char(opponent < 0 ? -1 : labels[opponent]);
+        }
+    }
+
+    return key + window;
+}
+
+ScheduleCount ScheduleCounter::countWeeks(int week) {
+    week = nextWeek(week);
+    if (week > weeks) {
+        return isValid() ? 1 : 0;
+    }
+
+    std::string key = getStateKey(week);
+    auto it = counts.find(key);
+    if (it != counts.end()) {
+        return it->second;
+    }
+    if (counts.size() >= maxStates) {
+        exceeded = true;
+        return 0;
+    }
+
+    ScheduleCount total = countMatchups(week);
+    if (!exceeded) {
+        counts.emplace(std::move(key), total);
+    }
+    return total;
+}
+
+// Counts the ways to finish `week` and every week after it.
+ScheduleCount ScheduleCounter::countMatchups(int week) {
+    int entity = nextEntity(week);
+    if (entity < 0) {
+        return countWeeks(week + 1);
+    }
+
+    ScheduleCount total = 0;
+    for (int opponent = entity + 1; opponent < numEntities && !exceeded;
+         opponent++) {
+        if (!canPlay(week, entity, opponent)) continue;
+
+        placeMatchup(week, entity, opponent);
+        total = addCounts(total, countMatchups(week));
+        removeMatchup(week, entity, opponent);
+    }
+
+    return total;
+}
+
+void ScheduleCounter::enumerateWeeks(
+    int week,
+    const std::function<void(const std::vector<int>&)>& visit
+) {
+    week = nextWeek(week);
+    if (week > weeks) {
+        if (isValid()) {
+            visit(schedule);
+        }
+        return;
+    }
+
+    auto it = counts.find(getStateKey(week));
+    if (it != counts.end() && it->second == 0) {
+        return;
+    }
+
+    enumerateMatchups(week, visit);
+}
+
+void ScheduleCounter::enumerateMatchups(
+    int week,
+    const std::function<void(const std::vector<int>&)>& visit
+) {
+    int entity = nextEntity(week);
+    if (entity < 0) {
+        enumerateWeeks(week + 1, visit);
+        return;
+    }
+
+    for (int opponent = entity + 1; opponent < numEntities; opponent++) {
+        if (!canPlay(week, entity, opponent)) continue;
+
+        placeMatchup(week, entity, opponent);
+        enumerateMatchups(week, visit);
+        removeMatchup(week, entity, opponent);
+    }
+}
+
+// Returns the first week from `week` on that is not pinned.
+int ScheduleCounter::nextWeek(int week) const {
+    while (week <= weeks && pinnedWeeks[week - 1]) {
+        ++week;
+    }
+    return week;
+}
+
+// Returns the lowest entity without a matchup in `week`, or -1.
+int ScheduleCounter::nextEntity(int week) const {
+    const int* matchups = &schedule[(week - 1) * numEntities];
+    for (int entity = 0; entity < numEntities; entity++) {
+        if (matchups[entity] < 0) {
+            return entity;
+        }
+    }
+    return -1;
+}
+
+// The same check as `Scheduler::checkMatchup`.
+bool ScheduleCounter::canPlay(int week, int entity, int opponent) const {
+    if (remaining[entity * numEntities + opponent] <= 0) {
+        return false;
+    }
+    if (schedule[(week - 1) * numEntities + opponent] >= 0) {
+        return false;
+    }
+
+    int startIndex = std::max(week - 1 - weeksBetweenMatchups, 0);
+    int endIndex = std::min(week - 1 + weeksBetweenMatchups, weeks - 1);
+    for (int i = startIndex; i <= endIndex; i++) {
+        if (schedule[i * numEntities + entity] == opponent) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ScheduleCounter::isValid() {
+    Violation violation =
+        validator.validate(schedule, matchupCounts, lastMatchupWeeks);
+    return violation.type == ViolationType::None;
+}
+
+void ScheduleCounter::placeMatchup(int week, int entity, int opponent) {
+    schedule[(week - 1) * numEntities + entity] = opponent;
+    schedule[(week - 1) * numEntities + opponent] = entity;
+    --remaining[entity * numEntities + opponent];
+    --remaining[opponent * numEntities + entity];
+}
+
+void ScheduleCounter::removeMatchup(int week, int entity, int opponent) {
+    schedule[(week - 1) * numEntities + entity] = -1;
+    schedule[(week - 1) * numEntities + opponent] = -1;
+    ++remaining[entity * numEntities + opponent];
+    ++remaining[opponent * numEntities + entity];
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "validator.h"
+
+// Exact schedule counts can exceed 64 bits. Sums saturate at the largest
+// value instead of wrapping.
+typedef unsigned __int128 ScheduleCount;
+
+std::string formatScheduleCount(ScheduleCount count);
+
+// Counts the valid schedules (see `ScheduleValidator`) of a league with
+// dynamic programming over the weeks. Before each week, all that decides
+// how the rest of the schedule can be filled is which matchups are still
+// owed and who played in the last `weeksBetweenMatchups` weeks, so the
+// count is memoized on that state. Entities that can be swapped without
+// changing the owed matchups or pinned weeks are interchangeable, and
+// states that only differ by such swaps share one memo entry.
+class ScheduleCounter {
+public:
+    ScheduleCounter(
+        int weeks_,
+        int numEntities_,
+        int weeksBetweenMatchups_,
+        std::vector<int> owedMatchups_,
+        std::vector<int> pinnedSchedule_
+    );
+    bool count(long maxStates, ScheduleCount& result);
+    double estimate(long probes, std::mt19937& rng, double& relativeError);
+    void enumerate(const std::function<void(const std::vector<int>&)>& visit);
+    long getNumStates() const;
+    int getNumSymmetryClasses() const;
+
+private:
+    int weeks;
+    int numEntities;
+    int weeksBetweenMatchups;
+    std::vector<int> owedMatchups;
+    std::vector<int> pinnedSchedule;
+    std::vector<bool> pinnedWeeks;
+    ScheduleValidator validator;
+    // The entities each entity is interchangeable with share a class.
+    std::vector<int> entityClasses;
+    int numSymmetryClasses;
+    // Every entity, grouped by class and in index order within a class.
+    std::vector<int> classMembers;
+    // The partial schedule and the matchups it still owes, as in
+    // `SearchState`.
+    std::vector<int> schedule;
+    std::vector<int> remaining;
+    std::vector<int> matchupCounts;
+    std::vector<int> lastMatchupWeeks;
+    std::unordered_map<std::string, ScheduleCount> counts;
+    long maxStates;
+    bool exceeded;
+    // Scratch for building state keys.
+    std::vector<std::vector<int>> signatures;
+    std::vector<int> order;
+    std::vector<int> labels;
+    void findSymmetries();
+    bool isSymmetric(int entity, int other) const;
+    void reset();
+    std::string getStateKey(int week);
+    ScheduleCount countWeeks(int week);
+    ScheduleCount countMatchups(int week);
+    void enumerateWeeks(
+        int week,
+        const std::function<void(const std::vector<int>&)>& visit
+    );
+    void enumerateMatchups(
+        int week,
+        const std::function<void(const std::vector<int>&)>& visit
+    );
+    int nextWeek(int week) const;
+    int nextEntity(int week) const;
+    bool canPlay(int week, int entity, int opponent) const;
+    bool isValid();
+    void placeMatchup(int week, int entity, int opponent);
+    void removeMatchup(int week, int entity, int opponent);
+};
@@ -0,0 +1,366 @@
+#include "daemon.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "json.h"
+
+namespace {
+
+std::string getString(
+    const JsonObject& object,
+    const std::string& key,
+    const std::string& fallback
+) {
+    auto it = object.find(key);
+    return it == object.end() ? fallback : it->second;
+}
+
+int getInt(const JsonObject& object, const std::string& key, int fallback) {
+    auto it = object.find(key);
+    if (it == object.end()) {
+        return fallback;
+    }
+
+    try {
+        return std::stoi(it->second);
+    } catch (const std::exception&) {
+        throw std::invalid_argument(
+            "Error reading job: " + key + " must be an integer."
+        );
+    }
+}
+
+double getDouble(
+    const JsonObject& object,
+    const std::string& key,
+    double fallback
+) {
+    auto it = object.find(key);
+    if (it == object.end()) {
+        return fallback;
+    }
+
+    try {
+        return std::stod(it->second);
+    } catch (const std::exception&) {
+        throw std::invalid_argument(
+            "Error reading job: " + key + " must be a number."
+        );
+    }
+}
+
+bool getBool(const JsonObject& object, const std::string& key, bool fallback) {
+    auto it = object.find(key);
+    return it == object.end() ? fallback : it->second == "true";
+}
+
+// Whether `id` can be used as a directory name without escaping the
+// default output directory.
+bool isPathSafe(const std::string& id) {
+    if (id.empty() || id == "." || id == "..") {
+        return false;
+    }
+
+    return std::all_of(id.begin(), id.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' ||
+               c == '_' || c == '.';
+    });
+}
+
+std::string status(const std::string& id, const std::string& status) {
+    return "{\"id\":" + quoteJson(id) + ",\"status\":" + quoteJson(status);
+}
+
+}  // namespace
+
+Daemon::Connection::~Connection() { close(fd); }
+
+void Daemon::Connection::send(const std::string& message) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    std::string line = message + "\n";
+    size_t sent = 0;
+    while (sent < line.size()) {
+        ssize_t n =
+            ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            // The client has gone away; drop the message.
+            return;
+        }
+        sent += n;
+    }
+}
+
+Daemon::Daemon(
+    std::string socketPath_,
+    LeagueConfig defaults_,
+    int numThreads
+)
+    : socketPath(socketPath_),
+      defaults(defaults_),
+      pool(numThreads),
+      nextJobId(0) {}
+
+// Accepts connections until the process is stopped.
+void Daemon::run() {
+    int serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverFd < 0) {
+        throw std::runtime_error(
+            std::string("Error creating socket: ") + strerror(errno)
+        );
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument(
+            "Error creating socket: the path " + socketPath + " is too long."
+        );
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path));
+
+    unlink(socketPath.c_str());
+    if (bind(serverFd, (sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(serverFd, SOMAXCONN) < 0) {
+        throw std::runtime_error(
+            "Error listening on " + socketPath + ": " + strerror(errno)
+        );
+    }
+
+    while (true) {
+        int clientFd = accept(serverFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(
+                std::string("Error accepting connection: ") + strerror(errno)
+            );
+        }
+
+        auto connection = std::make_shared<Connection>(clientFd);
+        std::thread(&Daemon::serve, this, connection).detach();
+    }
+}
+
+// Reads newline-delimited messages from a client. When the client
+// disconnects, its unfinished jobs are cancelled.
+void Daemon::serve(std::shared_ptr<Connection> connection) {
+    std::string buffer;
+    char chunk[4096];
+
+    while (true) {
+        ssize_t n = recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        buffer.append(chunk, n);
+
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+            std::string message = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+
+            if (message.find_first_not_of(" \t\r") != std::string::npos) {
+                handleMessage(message, connection);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    for (auto& [id, job] : jobs) {
+        if (job->connection == connection) {
+            job->cancelled = true;
+        }
+    }
+}
+
+void Daemon::handleMessage(
+    const std::string& message,
+    const std::shared_ptr<Connection>& connection
+) {
+    JsonObject request;
+    std::string id;
+    try {
+        request = parseJsonObject(message);
+        id = getString(request, "id", "");
+
+        if (getString(request, "type", "schedule") == "cancel") {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            auto job = jobs.find(id);
+            if (job != jobs.end()) {
+                job->second->cancelled = true;
+            } else {
+                connection->send(
+                    status(id, "error") +
+                    ",\"message\":\"No such job.\"}"
+                );
+            }
+            return;
+        }
+
+        auto job = std::make_shared<Job>();
+        job->priority = getInt(request, "priority", 0);
+        job->cancelled = false;
+        job->connection = connection;
+
+        LeagueConfig& config = job->config;
+        config.leagueId = getString(request, "leagueId", defaults.leagueId);
+        config.update = getBool(request, "update", defaults.update);
+        config.weeks = getInt(request, "weeks", defaults.weeks);
+        config.weeksBetweenMatchups = getInt(
+            request, "weeksBetweenMatchups", defaults.weeksBetweenMatchups
+        );
+        config.numSchedules =
+            getInt(request, "schedules", defaults.numSchedules);
+        config.searchThreads =
+            getInt(request, "searchThreads", defaults.searchThreads);
+        config.heuristics = SearchHeuristics{
+            getBool(request, "mrv", defaults.heuristics.minimumRemainingValues),
+            getBool(request, "lcv", defaults.heuristics.leastConstrainingValue),
+            getBool(request, "luby", defaults.heuristics.lubyRestarts),
+            getInt(request, "restartUnit", defaults.heuristics.restartUnit)
+        };
+        config.matchingEngine =
+            getBool(request, "matchingEngine", defaults.matchingEngine);
+        config.nogoodCacheSize =
+            getInt(request, "nogoodCacheSize", defaults.nogoodCacheSize);
+        config.criteriaBias =
+            getDouble(request, "criteriaBias", defaults.criteriaBias);
+        config.timeBudget =
+            getDouble(request, "timeBudget", defaults.timeBudget);
+        config.dataPath = getString(request, "dataDir", defaults.dataPath);
+        config.logoPath = getString(request, "logoPath", defaults.logoPath);
+        config.title = getString(request, "title", defaults.title);
+
+        {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            if (id.empty()) {
+                id = std::to_string(++nextJobId);
+            }
+            if (jobs.contains(id)) {
+                connection->send(
+                    status(id, "error") +
+                    ",\"message\":\"A job with this id is already queued.\"}"
+                );
+                return;
+            }
+
+            // Each job cleans its output directory, so by default every
+            // job writes to its own directory, and no two jobs may share
+            // one.
+            if (request.contains("outputDir")) {
+                config.outputPath = request.at("outputDir");
+            } else if (isPathSafe(id)) {
+                config.outputPath = defaults.outputPath + "/" + id;
+            } else {
+                connection->send(
+                    status(id, "error") +
+                    ",\"message\":\"Jobs without an outputDir need an id "
+                    "made of letters, digits, '-', '_' and '.'.\"}"
+                );
+                return;
+            }
+            for (const auto& [otherId, other] : jobs) {
+                if (outputPathsOverlap(
+                        config.outputPath, other->config.outputPath
+                    )) {
+                    connection->send(
+                        status(id, "error") +
+                        ",\"message\":\"Job " + otherId +
+                        " is already writing to this output directory.\"}"
+                    );
+                    return;
+                }
+            }
+            job->id = id;
+            jobs[id] = job;
+        }
+
+        connection->send(status(id, "queued") + "}");
+        pool.submit(job->priority, [this, job] { runJob(job); });
+    } catch (const std::exception& e) {
+        connection->send(
+            status(id, "error") + ",\"message\":" + quoteJson(e.what()) + "}"
+        );
+    }
+}
+
+void Daemon::runJob(std::shared_ptr<Job> job) {
+    auto start = std::chrono::steady_clock::now();
+
+    try {
+        if (!job->cancelled) {
+            job->connection->send(status(job->id, "running") + "}");
+
+            std::shared_ptr<const LeagueData> data = getLeagueData(job->config);
+            // Report each schedule as it is found, since a large job can
+            // search for a long time before its output is written.
+            auto found = [&job](const ScoredSchedule& sched, int count) {
+                job->connection->send(
+                    status(job->id, "found") +
+                    ",\"count\":" + std::to_string(count) +
+                    ",\"score\":" + std::to_string(sched.score) + "}"
+                );
+            };
+            LeagueResult result =
+                scheduleLeague(job->config, *data, &job->cancelled, found);
+
+            for (int i = 0; i < result.schedules.size(); i++) {
+                job->connection->send(
+                    status(job->id, "schedule") + ",\"rank\":" +
+                    std::to_string(i + 1) + ",\"score\":" +
+                    std::to_string(result.schedules[i].score) +
+                    ",\"path\":" + quoteJson(result.outputPaths[i]) + "}"
+                );
+            }
+        }
+
+        if (job->cancelled) {
+            job->connection->send(status(job->id, "cancelled") + "}");
+        } else {
+            std::chrono::duration<double> seconds =
+                std::chrono::steady_clock::now() - start;
+            job->connection->send(
+                status(job->id, "done") +
+                ",\"seconds\":" + std::to_string(seconds.count()) + "}"
+            );
+        }
+    } catch (const std::exception& e) {
+        job->connection->send(
+            status(job->id, "error") + ",\"message\":" + quoteJson(e.what()) +
+            "}"
+        );
+    }
+
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    jobs.erase(job->id);
+}
+
+// Returns the league inputs for a job, loading them on first use. A job
+// that asks for updated data always reloads.
+std::shared_ptr<const LeagueData> Daemon::getLeagueData(
+    const LeagueConfig& config
+) {
+    std::string key = config.leagueId + "\n" + config.dataPath + "\n" +
+                      std::to_string(config.weeks);
+
+    if (!config.update) {
+        std::lock_guard<std::mutex> lock(leaguesMutex);
+        auto league = leagues.find(key);
+        if (league != leagues.end()) {
+            return league->second;
+        }
+    }
+
+    auto data = std::make_shared<const LeagueData>(loadLeagueData(config));
+
+    std::lock_guard<std::mutex> lock(leaguesMutex);
+    leagues[key] = data;
+    return data;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "league.h"
+#include "thread_pool.h"
+
+// Serves scheduling jobs over a Unix domain socket. Clients send one JSON
+// object per line and receive newline-delimited JSON status updates. League
+// inputs stay loaded between jobs, and jobs share one thread pool.
+//
+// A job is {"id": ..., "priority": ..., "leagueId": ..., "update": ...,
+// "weeks": ..., "weeksBetweenMatchups": ..., "schedules": ...,
+// "searchThreads": ..., "mrv": ..., "lcv": ..., "luby": ...,
+// "restartUnit": ..., "matchingEngine": ..., "nogoodCacheSize": ...,
+// "criteriaBias": ..., "timeBudget": ..., "dataDir": ..., "outputDir": ...,
+// "logoPath": ..., "title": ...};
+// omitted fields fall back to config.toml, except that `outputDir`
+// defaults to output/<id>. A job is refused if another queued or running
+// job writes to the same output directory. {"type": "cancel", "id": ...}
+// cancels a queued or running job.
+//
+// A job's updates have the status "queued", "running", "found" with the
+// number of schedules found so far and the new schedule's score, one
+// "schedule" per written schedule with its rank, score and path, then
+// "done", "cancelled" or "error".
+class Daemon {
+public:
+    Daemon(std::string socketPath_, LeagueConfig defaults_, int numThreads);
+    void run();
+
+private:
+    struct Connection {
+        int fd;
+        std::mutex writeMutex;
+
+        Connection(int fd_) : fd(fd_) {}
+        ~Connection();
+        void send(const std::string& message);
+    };
+
+    struct Job {
+        std::string id;
+        int priority;
+        LeagueConfig config;
+        std::atomic<bool> cancelled;
+        std::shared_ptr<Connection> connection;
+    };
+
+    std::string socketPath;
+    LeagueConfig defaults;
+    ThreadPool pool;
+    long nextJobId;
+    std::mutex jobsMutex;
+    std::unordered_map<std::string, std::shared_ptr<Job>> jobs;
+    std::mutex leaguesMutex;
+    std::unordered_map<std::string, std::shared_ptr<const LeagueData>> leagues;
+    void serve(std::shared_ptr<Connection> connection);
+    void handleMessage(
+        const std::string& message,
+        const std::shared_ptr<Connection>& connection
+    );
+    void runJob(std::shared_ptr<Job> job);
+    std::shared_ptr<const LeagueData> getLeagueData(const LeagueConfig& c);
+};
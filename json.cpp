@@ -0,0 +1,178 @@
+#include "json.h"
+
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+void skipWhitespace(const std::string& text, size_t& i) {
+    while (i < text.size() && std::isspace(text[i])) {
+        ++i;
+    }
+}
+
+void expect(const std::string& text, size_t& i, char c) {
+    skipWhitespace(text, i);
+    if (i >= text.size() || text[i] != c) {
+        throw std::invalid_argument(
+            std::string("Error parsing JSON: expected '") + c +
+            "' at position " + std::to_string(i) + "."
+        );
+    }
+    ++i;
+}
+
+void appendUtf8(std::string& out, unsigned int codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+std::string parseString(const std::string& text, size_t& i) {
+    expect(text, i, '"');
+
+    std::string value;
+    while (i < text.size() && text[i] != '"') {
+        char c = text[i++];
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+
+        if (i >= text.size()) break;
+        char escaped = text[i++];
+        switch (escaped) {
+            case 'b':
+                value += '\b';
+                break;
+            case 'f':
+                value += '\f';
+                break;
+            case 'n':
+                value += '\n';
+                break;
+            case 'r':
+                value += '\r';
+                break;
+            case 't':
+                value += '\t';
+                break;
+            case 'u':
+                if (i + 4 > text.size()) {
+                    throw std::invalid_argument(
+                        "Error parsing JSON: truncated \\u escape."
+                    );
+                }
+                appendUtf8(value, std::stoul(text.substr(i, 4), nullptr, 16));
+                i += 4;
+                break;
+            default:
+                value += escaped;
+        }
+    }
+
+    expect(text, i, '"');
+    return value;
+}
+
+// Reads a number, boolean or null as its literal text.
+std::string parseLiteral(const std::string& text, size_t& i) {
+    skipWhitespace(text, i);
+
+    size_t start = i;
+    while (i < text.size() && text[i] != ',' && text[i] != '}' &&
+           !std::isspace(text[i])) {
+        if (text[i] == '{' || text[i] == '[') {
+            throw std::invalid_argument(
+                "Error parsing JSON: nested values are not supported."
+            );
+        }
+        ++i;
+    }
+
+    if (i == start) {
+        throw std::invalid_argument(
+            "Error parsing JSON: missing value at position " +
+            std::to_string(i) + "."
+        );
+    }
+    return text.substr(start, i - start);
+}
+
+}  // namespace
+
+JsonObject parseJsonObject(const std::string& text) {
+    JsonObject object;
+    size_t i = 0;
+
+    expect(text, i, '{');
+    skipWhitespace(text, i);
+    if (i < text.size() && text[i] == '}') {
+        return object;
+    }
+
+    while (true) {
+        skipWhitespace(text, i);
+        std::string key = parseString(text, i);
+        expect(text, i, ':');
+
+        skipWhitespace(text, i);
+        if (i < text.size() && text[i] == '"') {
+            object[key] = parseString(text, i);
+        } else {
+            object[key] = parseLiteral(text, i);
+        }
+
+        skipWhitespace(text, i);
+        if (i < text.size() && text[i] == ',') {
+            ++i;
+        } else {
+            break;
+        }
+    }
+
+    expect(text, i, '}');
+    return object;
+}
+
+std::string quoteJson(const std::string& value) {
+    std::string quoted = "\"";
+
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                quoted += "\\\"";
+                break;
+            case '\\':
+                quoted += "\\\\";
+                break;
+            case '\n':
+                quoted += "\\n";
+                break;
+            case '\r':
+                quoted += "\\r";
+                break;
+            case '\t':
+                quoted += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    quoted += escaped;
+                } else {
+                    quoted += c;
+                }
+        }
+    }
+
+    return quoted + "\"";
+}
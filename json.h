@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+// The members of a flat JSON object. String values are unescaped; other
+// values (numbers, booleans, null) are kept as their literal text.
+typedef std::unordered_map<std::string, std::string> JsonObject;
+
+JsonObject parseJsonObject(const std::string& text);
+std::string quoteJson(const std::string& value);
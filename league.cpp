@@ -0,0 +1,80 @@
+#include "league.h"
+
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+
+#include "nfl.h"
+
+LeagueData loadLeagueData(const LeagueConfig& config) {
+    std::time_t time = std::time(nullptr);
+    std::tm timeInfo;
+    localtime_r(&time, &timeInfo);
+    int previousYear = 1900 + timeInfo.tm_year - 1;
+
+    Nfl nfl(config.leagueId, config.update, previousYear, config.dataPath);
+
+    LeagueData data;
+    data.entities = nfl.getManagers();
+    data.matchupConstraints = nfl.getMatchupConstraints();
+    data.scheduleConstraints = nfl.getScheduleConstraints(config.weeks);
+
+    return data;
+}
+
+// Whether the two output directories are the same or one contains the
+// other, in which case cleaning one would delete the other's schedules.
+bool outputPathsOverlap(const std::string& path, const std::string& other) {
+    std::filesystem::path a =
+        std::filesystem::absolute(path).lexically_normal();
+    std::filesystem::path b =
+        std::filesystem::absolute(other).lexically_normal();
+    auto [endA, endB] = std::mismatch(a.begin(), a.end(), b.begin(), b.end());
+
+    // A trailing separator leaves an empty last component.
+    return (endA == a.end() || endA->empty()) ||
+           (endB == b.end() || endB->empty());
+}
+
+Scheduler createScheduler(const LeagueConfig& config, const LeagueData& data) {
+    Scheduler scheduler(
+        config.weeks,
+        data.entities,
+        data.matchupConstraints,
+        data.scheduleConstraints,
+        config.weeksBetweenMatchups,
+        config.dataPath,
+        config.outputPath,
+        config.logoPath,
+        config.title
+    );
+    scheduler.setSearchThreads(config.searchThreads);
+    scheduler.setSearchHeuristics(config.heuristics);
+    scheduler.setMatchingEngine(config.matchingEngine);
+    scheduler.setNogoodCacheSize(config.nogoodCacheSize);
+    scheduler.setCriteriaBias(config.criteriaBias);
+    scheduler.setTimeBudget(config.timeBudget);
+
+    return scheduler;
+}
+
+LeagueResult scheduleLeague(
+    const LeagueConfig& config,
+    const LeagueData& data,
+    const std::atomic<bool>* cancelled,
+    const ScheduleListener& found
+) {
+    Scheduler scheduler = createScheduler(config, data);
+
+    LeagueResult result;
+    result.schedules =
+        scheduler.createSchedules(config.numSchedules, cancelled, found);
+    for (int i = 0; i < result.schedules.size(); i++) {
+        result.outputPaths.push_back(
+            scheduler.getOutputFilePath(i, result.schedules[i])
+        );
+    }
+    result.stats = scheduler.getSearchStats();
+
+    return result;
+}
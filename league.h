@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "scheduler.h"
+
+// The parameters for scheduling one league.
+struct LeagueConfig {
+    std::string leagueId;
+    bool update;
+    int weeks;
+    int weeksBetweenMatchups;
+    int numSchedules;
+    int searchThreads;
+    SearchHeuristics heuristics;
+    bool matchingEngine;
+    // Search states to remember as dead ends, or 0 to remember none.
+    int nogoodCacheSize;
+    // Probability of choosing an opponent that meets a scoring criterion.
+    double criteriaBias;
+    // Seconds allowed for scheduling the league, or 0 for no limit.
+    double timeBudget;
+    std::string dataPath;
+    std::string outputPath;
+    std::string logoPath;
+    std::string title;
+};
+
+// The inputs to the scheduler for one league, read from the data
+// directory or scraped from fantasy.nfl.com.
+struct LeagueData {
+    std::vector<std::string> entities;
+    MatchupConstraints matchupConstraints;
+    ScheduleConstraints scheduleConstraints;
+};
+
+// The schedules written for one league, best first.
+struct LeagueResult {
+    std::vector<ScoredSchedule> schedules;
+    std::vector<std::string> outputPaths;
+    SearchStats stats;
+};
+
+LeagueData loadLeagueData(const LeagueConfig& config);
+bool outputPathsOverlap(const std::string& path, const std::string& other);
+Scheduler createScheduler(const LeagueConfig& config, const LeagueData& data);
+LeagueResult scheduleLeague(
+    const LeagueConfig& config,
+    const LeagueData& data,
+    const std::atomic<bool>* cancelled,
+    const ScheduleListener& found = nullptr
+);
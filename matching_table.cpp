@@ -0,0 +1,74 @@
+#include "matching_table.h"
+
+#include <stdexcept>
+#include <string>
+
+MatchingTable::MatchingTable(int numEntities_) : numEntities(numEntities_) {
+    if (numEntities % 2 != 0 || numEntities > maxEntities) {
+        throw std::invalid_argument(
+            "The matching table requires an even number of at most " +
+            std::to_string(maxEntities) + " entities."
+        );
+    }
+
+    pairIndices.assign(numEntities * numEntities, -1);
+    int pairIndex = 0;
+    for (int entity = 0; entity < numEntities; entity++) {
+        for (int opponent = entity + 1; opponent < numEntities; opponent++) {
+            pairIndices[entity * numEntities + opponent] = pairIndex;
+            pairIndices[opponent * numEntities + entity] = pairIndex;
+            ++pairIndex;
+        }
+    }
+
+    std::vector<std::int8_t> matching(numEntities, -1);
+    PairMask mask;
+    enumerate(matching, mask);
+}
+
+int MatchingTable::size() const { return masks.size(); }
+
+int MatchingTable::getPairIndex(int entity, int opponent) const {
+    return pairIndices[entity * numEntities + opponent];
+}
+
+const PairMask& MatchingTable::getMask(int matching) const {
+    return masks[matching];
+}
+
+const std::int8_t* MatchingTable::getPartners(int matching) const {
+    return &partners[matching * numEntities];
+}
+
+// Pairs the first unmatched entity with each unmatched entity after it in
+// turn, recording every complete matching.
+void MatchingTable::enumerate(
+    std::vector<std::int8_t>& matching,
+    PairMask& mask
+) {
+    int entity = 0;
+    while (entity < numEntities && matching[entity] >= 0) {
+        ++entity;
+    }
+
+    if (entity == numEntities) {
+        masks.push_back(mask);
+        partners.insert(partners.end(), matching.begin(), matching.end());
+        return;
+    }
+
+    for (int opponent = entity + 1; opponent < numEntities; opponent++) {
+        if (matching[opponent] >= 0) continue;
+
+        int pairIndex = getPairIndex(entity, opponent);
+        matching[entity] = opponent;
+        matching[opponent] = entity;
+        mask.set(pairIndex);
+
+        enumerate(matching, mask);
+
+        matching[entity] = -1;
+        matching[opponent] = -1;
+        mask.reset(pairIndex);
+    }
+}
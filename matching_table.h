@@ -0,0 +1,31 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+// A set of pairs of entities. Each pair has one bit, given by
+// `MatchingTable::getPairIndex`.
+typedef std::bitset<128> PairMask;
+
+// Every perfect matching of an even number of entities, i.e. every
+// possible set of matchups for one week. 12 entities have 10,395 matchings
+// and 14 have 135,135, so larger leagues are not supported.
+class MatchingTable {
+public:
+    static const int maxEntities = 14;
+
+    MatchingTable(int numEntities_);
+    int size() const;
+    int getPairIndex(int entity, int opponent) const;
+    const PairMask& getMask(int matching) const;
+    const std::int8_t* getPartners(int matching) const;
+
+private:
+    int numEntities;
+    std::vector<int> pairIndices;
+    std::vector<PairMask> masks;
+    // The opponent of each entity, `numEntities` entries per matching.
+    std::vector<std::int8_t> partners;
+    void enumerate(std::vector<std::int8_t>& matching, PairMask& mask);
+};
@@ -2,10 +2,19 @@
 
 #include <cstring>
 
-Nfl::Nfl(std::string id, bool u, int y) {
+Nfl::Nfl(std::string id, bool u, int y, std::string d) {
     leagueId = id;
     update = u;
     year = y;
+    dataPath = d;
+}
+
+// Sets up curl and libxml2. Neither library initializes itself safely
+// from several threads at once, so this must run on the main thread
+// before any league data is loaded.
+void Nfl::initializeLibraries() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    xmlInitParser();
 }
 
 size_t getCurlResponse(char *ptr, size_t size, size_t nmemb, void *data) {
@@ -109,7 +118,7 @@ void Nfl::parseStandings(xmlDoc *html) {
 
 std::vector<std::string> Nfl::getManagers() {
     std::vector<std::string> managerNames;
-    std::string filePath = "data/entities.txt";
+    std::string filePath = dataPath + "/entities.txt";
     struct stat buffer;
 
     if (update || stat(filePath.c_str(), &buffer) != 0) {
@@ -155,7 +164,7 @@ void Nfl::getStandings() {
 
 MatchupConstraints Nfl::getMatchupConstraints() {
     MatchupConstraints constraints;
-    std::string filePath = "data/constraints.txt";
+    std::string filePath = dataPath + "/constraints.txt";
     struct stat buffer;
 
     if (update || stat(filePath.c_str(), &buffer) != 0) {
@@ -222,7 +231,7 @@ MatchupConstraints Nfl::getMatchupConstraints() {
 }
 
 ScheduleConstraints Nfl::getScheduleConstraints(int weeks) {
-    std::ifstream scheduleFile("data/schedule-constraints.txt");
+    std::ifstream scheduleFile(dataPath + "/schedule-constraints.txt");
     ScheduleConstraints constraints;
     std::string line;
     int week = 0;
@@ -22,7 +22,8 @@ struct HtmlElement {
 
 class Nfl {
 public:
-    Nfl(std::string id, bool u, int y);
+    Nfl(std::string id, bool u, int y, std::string d);
+    static void initializeLibraries();
     std::vector<std::string> getManagers();
     MatchupConstraints getMatchupConstraints();
     ScheduleConstraints getScheduleConstraints(int weeks);
@@ -31,6 +32,7 @@ private:
     std::string leagueId;
     bool update;
     int year;
+    std::string dataPath;
     std::unordered_map<std::string, std::string> managers;
     std::unordered_map<std::string, int> standings;
     xmlDoc *scrape(const char *url);
@@ -0,0 +1,105 @@
+#include "nogood_store.h"
+
+#include <algorithm>
+
+namespace {
+
+// The splitmix64 finalizer.
+std::uint64_t mix(std::uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+}  // namespace
+
+NogoodKey::NogoodKey() : hash(0x9e3779b97f4a7c15ULL), check(0) {}
+
+void NogoodKey::add(std::uint64_t value) {
+    hash = mix(hash ^ value);
+    check = mix(check + value + 0x632be59bd9b4e019ULL);
+}
+
+NogoodStore::NogoodStore(int capacity_)
+    : capacity(std::max(capacity_, 1)), size(0), hand(0) {
+    entries.resize(capacity);
+
+    std::size_t numSlots = 1;
+    while (numSlots < 2 * static_cast<std::size_t>(capacity)) {
+        numSlots *= 2;
+    }
+    slots.assign(numSlots, -1);
+    slotMask = numSlots - 1;
+}
+
+bool NogoodStore::contains(const NogoodKey& key) {
+    int index = slots[findSlot(key.hash)];
+    if (index < 0) {
+        return false;
+    }
+
+    Entry& entry = entries[index];
+    if (entry.key.check != key.check) {
+        return false;
+    }
+
+    entry.referenced = true;
+    return true;
+}
+
+void NogoodStore::insert(const NogoodKey& key) {
+    std::size_t slot = findSlot(key.hash);
+    if (slots[slot] >= 0) {
+        // Either the same state or a rare collision; keep the newer one.
+        entries[slots[slot]] = Entry{key, true};
+        return;
+    }
+
+    if (size < capacity) {
+        entries[size] = Entry{key, false};
+        slots[slot] = size++;
+        return;
+    }
+
+    // Give every recently used entry a second chance before evicting.
+    while (entries[hand].referenced) {
+        entries[hand].referenced = false;
+        hand = (hand + 1) % capacity;
+    }
+
+    // Erasing can move other entries' slots, so look the new key up again.
+    eraseSlot(findSlot(entries[hand].key.hash));
+    entries[hand] = Entry{key, false};
+    slots[findSlot(key.hash)] = hand;
+    hand = (hand + 1) % capacity;
+}
+
+// Returns the slot holding the entry with the given hash, or the empty
+// slot where such an entry would go.
+std::size_t NogoodStore::findSlot(std::uint64_t hash) const {
+    std::size_t slot = hash & slotMask;
+    while (slots[slot] >= 0 && entries[slots[slot]].key.hash != hash) {
+        slot = (slot + 1) & slotMask;
+    }
+    return slot;
+}
+
+// Empties `slot`. Later entries in the same run of full slots are moved
+// back into the gap when their probe passes through it, so every entry
+// stays reachable without leaving tombstones.
+void NogoodStore::eraseSlot(std::size_t slot) {
+    std::size_t next = slot;
+    while (true) {
+        next = (next + 1) & slotMask;
+        if (slots[next] < 0) {
+            break;
+        }
+
+        std::size_t home = entries[slots[next]].key.hash & slotMask;
+        if (((next - home) & slotMask) >= ((next - slot) & slotMask)) {
+            slots[slot] = slots[next];
+            slot = next;
+        }
+    }
+    slots[slot] = -1;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A 128-bit fingerprint of a search state. `hash` indexes the store and
+// `check` guards against two states sharing a hash.
+struct NogoodKey {
+    std::uint64_t hash;
+    std::uint64_t check;
+
+    NogoodKey();
+    void add(std::uint64_t value);
+};
+
+// A bounded set of search states known to have no valid completion. When
+// full, entries are evicted with the clock algorithm, so states that keep
+// being looked up survive longer than ones that are never seen again.
+// All memory is allocated up front, so lookups and inserts never
+// allocate.
+class NogoodStore {
+public:
+    NogoodStore(int capacity_);
+    bool contains(const NogoodKey& key);
+    void insert(const NogoodKey& key);
+
+private:
+    struct Entry {
+        NogoodKey key;
+        bool referenced;
+    };
+
+    int capacity;
+    int size;
+    std::vector<Entry> entries;
+    // An open-addressed hash table of indices into `entries`, -1 for an
+    // empty slot. A key is probed linearly from slot `hash & slotMask`.
+    // There are at least twice as many slots as entries, so probes stay
+    // short.
+    std::vector<int> slots;
+    std::size_t slotMask;
+    // The next entry the clock considers evicting.
+    int hand;
+    std::size_t findSlot(std::uint64_t hash) const;
+    void eraseSlot(std::size_t slot);
+};
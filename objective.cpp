@@ -0,0 +1,97 @@
+#include "objective.h"
+
+#include <cstdlib>
+
+Objective::Objective(
+    int weeks_,
+    int numEntities_,
+    int weeksBetweenMatchups_
+)
+    : weeks(weeks_),
+      numEntities(numEntities_),
+      weeksBetweenMatchups(weeksBetweenMatchups_),
+      rematchSpreadWeight(0),
+      matchupWeights(weeks_ * numEntities_ * numEntities_, 0) {}
+
+// Adds `weight` to the score of any schedule where entity and
+// opponent play each other in the given week. Negative weights
+// are penalties.
+void Objective::addMatchupWeight(
+    int week,
+    int entity,
+    int opponent,
+    int weight
+) {
+    int weekOffset = (week - 1) * numEntities;
+    matchupWeights[(weekOffset + entity) * numEntities + opponent] += weight;
+    matchupWeights[(weekOffset + opponent) * numEntities + entity] += weight;
+}
+
+// Rewards spreading repeated matchups apart: every two meetings of the
+// same pair add `weight` for each week they are separated by beyond
+// the required `weeksBetweenMatchups`.
+void Objective::setRematchSpreadWeight(int weight) {
+    rematchSpreadWeight = weight;
+}
+
+int Objective::getMatchupWeight(int week, int entity, int opponent) const {
+    int weekOffset = (week - 1) * numEntities;
+    return matchupWeights[(weekOffset + entity) * numEntities + opponent];
+}
+
+// Returns the change in score from entity and opponent playing in the
+// given week, where `schedule` holds every other scheduled matchup.
+// Removing the matchup changes the score by the negation.
+int Objective::getMatchupDelta(
+    const std::vector<int>& schedule,
+    int week,
+    int entity,
+    int opponent
+) const {
+    int delta = getMatchupWeight(week, entity, opponent);
+
+    if (rematchSpreadWeight != 0) {
+        for (int i = 0; i < weeks; i++) {
+            if (i == week - 1) continue;
+
+            if (schedule[i * numEntities + entity] == opponent) {
+                int spread = std::abs(week - 1 - i) - weeksBetweenMatchups;
+                delta += rematchSpreadWeight * spread;
+            }
+        }
+    }
+
+    return delta;
+}
+
+// Scores a schedule from scratch.
+int Objective::evaluate(const std::vector<int>& schedule) const {
+    int score = 0;
+
+    for (int week = 1; week <= weeks; week++) {
+        for (int entity = 0; entity < numEntities; entity++) {
+            int opponent = schedule[(week - 1) * numEntities + entity];
+            if (opponent > entity) {
+                score += getMatchupWeight(week, entity, opponent);
+            }
+        }
+    }
+
+    if (rematchSpreadWeight != 0) {
+        for (int entity = 0; entity < numEntities; entity++) {
+            for (int i = 0; i < weeks; i++) {
+                int opponent = schedule[i * numEntities + entity];
+                if (opponent <= entity) continue;
+
+                for (int j = i + 1; j < weeks; j++) {
+                    if (schedule[j * numEntities + entity] == opponent) {
+                        int spread = j - i - weeksBetweenMatchups;
+                        score += rematchSpreadWeight * spread;
+                    }
+                }
+            }
+        }
+    }
+
+    return score;
+}
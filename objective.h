@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+// A weighted scoring model over compact schedules. Every term is a sum over
+// scheduled matchups, so the change in score from placing or removing a
+// single matchup can be computed without rescoring the whole schedule.
+class Objective {
+public:
+    Objective(int weeks_, int numEntities_, int weeksBetweenMatchups_);
+    void addMatchupWeight(int week, int entity, int opponent, int weight);
+    void setRematchSpreadWeight(int weight);
+    int getMatchupWeight(int week, int entity, int opponent) const;
+    int getMatchupDelta(
+        const std::vector<int>& schedule,
+        int week,
+        int entity,
+        int opponent
+    ) const;
+    int evaluate(const std::vector<int>& schedule) const;
+
+private:
+    int weeks;
+    int numEntities;
+    int weeksBetweenMatchups;
+    int rematchSpreadWeight;
+    // Indexed by `((week - 1) * numEntities + entity) * numEntities +
+    // opponent`. The table is symmetric in entity and opponent.
+    std::vector<int> matchupWeights;
+};
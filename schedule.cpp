@@ -1,10 +1,19 @@
-#include <ctime>
+#include <algorithm>
+#include <string>
+#include <thread>
 #include <toml.hpp>
 
+#include "batch.h"
+#include "daemon.h"
+#include "league.h"
 #include "nfl.h"
-#include "scheduler.h"
+#include "toml_number.h"
+
+// Usage: schedule.o [--daemon <socket path> | --batch <manifest path> |
+//                    --count | --enumerate <CSV path>]
+int main(int argc, char *argv[]) {
+    Nfl::initializeLibraries();
 
-int main() {
     const auto config = toml::parse("config.toml");
     const auto &leagueConfig = toml::find(config, "LEAGUE");
     const std::string leagueId =
@@ -15,31 +24,84 @@ int main() {
     const int weeksBetweenMatchups =
         toml::find<int>(scheduleConfig, "NUM_WEEKS_BETWEEN_MATCHUPS");
     const int numSchedules = toml::find<int>(scheduleConfig, "NUM_SCHEDULES");
+    const int searchThreads =
+        toml::find_or<int>(scheduleConfig, "NUM_SEARCH_THREADS", 1);
+    const SearchHeuristics heuristics{
+        toml::find_or<bool>(scheduleConfig, "MRV_ORDERING", false),
+        toml::find_or<bool>(scheduleConfig, "LCV_ORDERING", false),
+        toml::find_or<bool>(scheduleConfig, "LUBY_RESTARTS", false),
+        toml::find_or<int>(scheduleConfig, "RESTART_UNIT", 100)
+    };
+    const bool matchingEngine =
+        toml::find_or<bool>(scheduleConfig, "MATCHING_ENGINE", false);
+    const int nogoodCacheSize =
+        toml::find_or<int>(scheduleConfig, "NOGOOD_CACHE_SIZE", 0);
+    const double criteriaBias =
+        toml::find_or<double>(scheduleConfig, "CRITERIA_BIAS", 0.0);
+    const double timeBudget =
+        findNumberOr(scheduleConfig, "TIME_BUDGET_SECONDS", 0);
+    const long countMaxStates =
+        toml::find_or<long>(scheduleConfig, "COUNT_MAX_STATES", 1000000);
+    const long countProbes =
+        toml::find_or<long>(scheduleConfig, "COUNT_PROBES", 100000);
+    const long enumerateLimit =
+        toml::find_or<long>(scheduleConfig, "ENUMERATE_LIMIT", 100000);
     const auto &outputConfig = toml::find(config, "OUTPUT");
     const std::string logoPath =
         toml::find<std::string>(outputConfig, "LOGO_PATH");
     const std::string title =
         toml::find<std::string>(outputConfig, "SCHEDULE_TITLE");
 
-    std::time_t time = std::time(nullptr);
-    const std::tm *timeInfo = std::localtime(&time);
-    int previousYear = 1900 + timeInfo->tm_year - 1;
-
-    Nfl nfl(leagueId, update, previousYear);
-    std::vector<std::string> entities = nfl.getManagers();
-    MatchupConstraints matchupConstraints = nfl.getMatchupConstraints();
-    ScheduleConstraints scheduleConstraints = nfl.getScheduleConstraints(weeks);
-
-    Scheduler scheduler(
+    LeagueConfig league{
+        leagueId,
+        update,
         weeks,
-        entities,
-        matchupConstraints,
-        scheduleConstraints,
         weeksBetweenMatchups,
+        numSchedules,
+        searchThreads,
+        heuristics,
+        matchingEngine,
+        nogoodCacheSize,
+        criteriaBias,
+        timeBudget,
+        "data",
+        "output",
         logoPath,
         title
-    );
-    scheduler.createSchedules(numSchedules);
+    };
+
+    if (argc == 3 && std::string(argv[1]) == "--daemon") {
+        const int cores = std::thread::hardware_concurrency();
+        Daemon daemon(argv[2], league, std::max(cores, 1));
+        daemon.run();
+        return 0;
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "--batch") {
+        runBatch(argv[2], league);
+        return 0;
+    }
+
+    LeagueData data = loadLeagueData(league);
+
+    // Counting and enumerating never search, so they skip the matching
+    // table, which needs an even number of entities.
+    LeagueConfig countConfig = league;
+    countConfig.matchingEngine = false;
+
+    if (argc == 2 && std::string(argv[1]) == "--count") {
+        Scheduler scheduler = createScheduler(countConfig, data);
+        scheduler.countSchedules(countMaxStates, countProbes);
+        return 0;
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "--enumerate") {
+        Scheduler scheduler = createScheduler(countConfig, data);
+        scheduler.enumerateSchedules(argv[2], countMaxStates, enumerateLimit);
+        return 0;
+    }
+
+    scheduleLeague(league, data, nullptr);
 
     return 0;
 }
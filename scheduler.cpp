@@ -1,28 +1,55 @@
 #include "scheduler.h"
 
+#include <condition_variable>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "work_stealing.h"
+
 Scheduler::Scheduler(
     int weeks_,
     std::vector<std::string> entities_,
     MatchupConstraints constraints_,
     ScheduleConstraints scheduleConstraints_,
     int weeksBetweenMatchups_,
+    std::string dataPath_,
+    std::string outputPath_,
     std::string logoPath_,
     std::string title_
 )
     : weeks(weeks_),
       entities(entities_),
-      constraints(constraints_),
-      constraintsCheck(constraints_),
-      scheduleConstraints(scheduleConstraints_),
+      numEntities(entities_.size()),
       weeksBetweenMatchups(weeksBetweenMatchups_),
+      searchThreads(1),
+      heuristics{false, false, false, 100},
+      stats{},
+      timeBudget(0),
+      cancelFlag(nullptr),
+      objective(weeks_, entities_.size(), weeksBetweenMatchups_),
+      criteriaBias(0),
+      dataPath(dataPath_),
+      outputPath(outputPath_),
       logoPath(logoPath_),
       title(title_) {
-    cleanOutputDirectory("output");
-    loadScoringCriteria("data/scoring-criteria.txt");
+    for (int i = 0; i < numEntities; i++) {
+        entityIndex[entities[i]] = i;
+    }
+
+    indexConstraints(constraints_, scheduleConstraints_);
+    validator = std::make_unique<ScheduleValidator>(
+        weeks, numEntities, weeksBetweenMatchups, owedMatchups, pinnedSchedule
+    );
+    resizeState(state);
+    loadScoringCriteria(dataPath + "/scoring-criteria.txt");
 }
 
 void Scheduler::cleanOutputDirectory(std::string outputPath) {
     std::filesystem::path outputDir(outputPath);
+    std::filesystem::create_directories(outputDir);
     for (const auto& entry : std::filesystem::directory_iterator(outputDir)) {
         std::filesystem::remove_all(entry.path());
     }
@@ -39,61 +66,161 @@ std::string Scheduler::createScheduleID(int n) {
     return id;
 }
 
-void Scheduler::initializeSchedule() {
-    schedule.clear();
-    constraints = constraintsCheck;
+// Converts the name-keyed constraints into flat arrays indexed by
+// entity, so the search never hashes or compares strings.
+void Scheduler::indexConstraints(
+    MatchupConstraints& matchupConstraints,
+    ScheduleConstraints& scheduleConstraints
+) {
+    owedMatchups.assign(numEntities * numEntities, 0);
+    for (const auto& [entity, opponents] : matchupConstraints) {
+        auto e = entityIndex.find(entity);
+        if (e == entityIndex.end()) continue;
 
-    for (int week = 1; week <= weeks; week++) {
-        Matchups matchups;
+        for (const auto& [opponent, numMatchups] : opponents) {
+            auto o = entityIndex.find(opponent);
+            if (o == entityIndex.end()) continue;
 
-        for (const auto& entity : entities) {
-            matchups[entity] = "";
+            owedMatchups[e->second * numEntities + o->second] = numMatchups;
         }
+    }
+
+    pinnedSchedule.assign(weeks * numEntities, -1);
+    pinnedWeeks.assign(weeks, false);
+    for (const auto& [week, matchups] : scheduleConstraints) {
+        pinnedWeeks[week - 1] = true;
+
+        for (const auto& [entity, opponent] : matchups) {
+            auto e = entityIndex.find(entity);
+            auto o = entityIndex.find(opponent);
+            if (e == entityIndex.end() || o == entityIndex.end()) {
+                throw std::invalid_argument(
+                    "Error reading schedule constraints: " + entity +
+                    " vs. " + opponent + " is not a matchup between " +
+                    "known entities."
+                );
+            }
 
-        schedule.push_back(matchups);
+            pinnedSchedule[(week - 1) * numEntities + e->second] = o->second;
+        }
     }
 }
 
-void Scheduler::printSchedule(Schedule& sched) {
+// Allocates every buffer the search needs up front. Nothing in the
+// attempt loop grows these buffers afterwards.
+void Scheduler::resizeState(SearchState& s) {
+    s.schedule.assign(weeks * numEntities, -1);
+    s.remaining.assign(numEntities * numEntities, 0);
+    s.matchupCounts.assign(numEntities * numEntities, 0);
+    s.lastMatchupWeeks.assign(numEntities * numEntities, 0);
+    s.unscheduled.clear();
+    s.unscheduled.reserve(numEntities);
+    s.candidates.clear();
+    s.candidates.reserve(numEntities);
+    s.candidateStack.assign((weeks * numEntities / 2 + 1) * numEntities, -1);
+    s.opponentOptions.assign(numEntities, 0);
+    s.rng.seed(time(0));
+}
+
+void Scheduler::initializeSchedule(SearchState& s) {
+    std::fill(s.schedule.begin(), s.schedule.end(), -1);
+    std::copy(owedMatchups.begin(), owedMatchups.end(), s.remaining.begin());
+    s.score = 0;
+    s.failures = 0;
+    s.failureLimit = std::numeric_limits<long>::max();
+}
+
+void Scheduler::printSchedule(CompactSchedule& sched) {
     for (int week = 1; week <= weeks; week++) {
         std::cout << "Week " << week << std::endl;
 
-        for (const auto& matchup : sched[week - 1]) {
+        for (int entity = 0; entity < numEntities; entity++) {
+            int opponent = sched[(week - 1) * numEntities + entity];
             std::cout << "\t";
-            std::cout << matchup.first << " - ";
-            std::cout << matchup.second << std::endl;
+            std::cout << entities[entity] << " - ";
+            std::cout << (opponent < 0 ? "" : entities[opponent]) << std::endl;
         }
     }
 }
 
-void Scheduler::createSchedules(int n) {
-    srand(time(0));
+// Generates `n` unique valid schedules and writes the highest scoring ten
+// to the output directory, replacing its contents. If the time budget
+// runs out first, the schedules found so far are written instead. Each
+// new schedule is passed to `found`, if given, as soon as it is found.
+// Returns the written schedules, best first, or nothing if `cancelled` is
+// set.
+std::vector<ScoredSchedule> Scheduler::createSchedules(
+    int n,
+    const std::atomic<bool>* cancelled,
+    const ScheduleListener& found
+) {
+    startTime = std::chrono::steady_clock::now();
+    cancelFlag = cancelled;
+    stats = SearchStats{};
+    cleanOutputDirectory(outputPath);
 
     std::vector<ScoredSchedule> schedules;
     while (schedules.size() < n) {
-        initializeSchedule();
-        insertScheduleConstraints();
-        scheduleWeek(1);
+        if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+            cancelFlag = nullptr;
+            return {};
+        }
+        if (isOutOfTime()) {
+            break;
+        }
+
+        initializeSchedule(state);
+        insertScheduleConstraints(state);
+        ++stats.attempts;
+        if (matchingTable) {
+            if (!searchWithRestarts(state, cancelled)) {
+                continue;
+            }
+        } else if (searchThreads > 1) {
+            if (!searchParallel(state, cancelled)) {
+                continue;
+            }
+        } else if (heuristics.lubyRestarts) {
+            if (!searchWithRestarts(state, cancelled)) {
+                continue;
+            }
+        } else {
+            // Backtracking a fixed number of weeks can get trapped
+            // rebuilding the same weeks forever, so abandon attempts
+            // that hit too many dead ends.
+            state.failureLimit = 1000L * weeks * numEntities;
+            scheduleWeek(state, 1);
+            stats.failures += state.failures;
+        }
+
+        if (validateSchedule(state)) {
+            ++stats.validSchedules;
 
-        if (validateSchedule()) {
             bool alreadyFound = std::any_of(
                 schedules.begin(),
                 schedules.end(),
                 [this](const ScoredSchedule& sched) {
-                    return sched.schedule == schedule;
+                    return sched.schedule == state.schedule;
                 }
             );
             if (alreadyFound) {
                 continue;
             }
 
-            ScoredSchedule scoredSchedule = scoreSchedule(schedule);
-            schedules.push_back(scoredSchedule);
-        } else {
-            std::cout << "Not a valid schedule" << std::endl;
+            schedules.push_back(scoreSchedule(state));
+            if (found) {
+                found(schedules.back(), schedules.size());
+            }
+        } else if (!isStopped()) {
+            // Attempts cut short by a cancellation or the time budget are
+            // simply unfinished, so only the others are reported.
+            printViolation(validator->validate(
+                state.schedule, state.matchupCounts, state.lastMatchupWeeks
+            ));
         }
     }
 
+    cancelFlag = nullptr;
     std::sort(
         schedules.begin(),
         schedules.end(),
@@ -102,81 +229,277 @@ void Scheduler::createSchedules(int n) {
         }
     );
 
-    int numFinalSchedules = std::min(n, 10);
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - startTime;
+    stats.seconds = seconds.count();
+    std::cout << "Attempts: " << stats.attempts
+              << ", valid schedules: " << stats.validSchedules
+              << ", dead ends: " << stats.failures
+              << ", restarts: " << stats.restarts << ", valid schedules/sec: "
+              << stats.validSchedules / stats.seconds << std::endl;
+    if (nogoods) {
+        long lookups = std::max(stats.nogoodLookups, 1L);
+        std::cout << "Nogood hits: " << stats.nogoodHits << " of "
+                  << stats.nogoodLookups << " lookups ("
+                  << 100.0 * stats.nogoodHits / lookups << "%)" << std::endl;
+    }
+
+    int numFinalSchedules = std::min<int>(schedules.size(), 10);
+    schedules.resize(numFinalSchedules);
     for (int i = 0; i < numFinalSchedules; ++i) {
-        std::string filePath = "output/schedule" + createScheduleID(i) + "-" +
-                               std::to_string(schedules[i].score);
-        generateOutput(schedules[i], filePath);
+        generateOutput(schedules[i], getOutputFilePath(i, schedules[i]));
+    }
+
+    return schedules;
+}
+
+// Prints the number of valid schedules. The count is exact when it needs
+// at most `maxStates` memoized states, and is otherwise estimated from
+// `probes` random probes of the search tree.
+void Scheduler::countSchedules(long maxStates, long probes) {
+    ScheduleCounter counter(
+        weeks, numEntities, weeksBetweenMatchups, owedMatchups, pinnedSchedule
+    );
+    std::cout << "Classes of interchangeable entities: "
+              << counter.getNumSymmetryClasses() << std::endl;
+
+    ScheduleCount count;
+    if (counter.count(maxStates, count)) {
+        std::cout << "Valid schedules: " << formatScheduleCount(count)
+                  << " (exact, " << counter.getNumStates() << " states)"
+                  << std::endl;
+        return;
     }
+
+    double relativeError;
+    double estimate = counter.estimate(probes, state.rng, relativeError);
+    std::cout << "Valid schedules: about " << estimate << " (more than "
+              << maxStates << " states; estimated from " << probes
+              << " probes with a relative standard error of "
+              << 100 * relativeError << "%)" << std::endl;
 }
 
-void Scheduler::insertScheduleConstraints() {
-    for (auto [week, matchups] : scheduleConstraints) {
-        for (auto [entity, opponent] : matchups) {
-            schedule[week - 1][entity] = opponent;
-            --constraints[entity][opponent];
+// Writes every valid schedule to the CSV file `filePath`, one per line
+// with its score, and writes the highest scoring ten to the output
+// directory like `createSchedules`. Throws if there are more than `limit`
+// valid schedules, or too many to count with `maxStates` states.
+std::vector<ScoredSchedule> Scheduler::enumerateSchedules(
+    std::string filePath,
+    long maxStates,
+    long limit
+) {
+    ScheduleCounter counter(
+        weeks, numEntities, weeksBetweenMatchups, owedMatchups, pinnedSchedule
+    );
+    ScheduleCount count;
+    if (!counter.count(maxStates, count) || count > limit) {
+        throw std::runtime_error(
+            "Too many valid schedules to enumerate; the limit is " +
+            std::to_string(limit) + "."
+        );
+    }
+
+    cleanOutputDirectory(outputPath);
+    std::ofstream file(filePath);
+    file << "Score";
+    for (int week = 1; week <= weeks; week++) {
+        file << ",Week " << week;
+    }
+    file << "\n";
+
+    std::vector<ScoredSchedule> schedules;
+    auto byScore = [](const ScoredSchedule& a, const ScoredSchedule& b) {
+        return a.score > b.score;
+    };
+    counter.enumerate([&](const CompactSchedule& sched) {
+        std::copy(sched.begin(), sched.end(), state.schedule.begin());
+        state.score = objective.evaluate(state.schedule);
+
+        file << state.score;
+        for (int week = 1; week <= weeks; week++) {
+            const int* matchups = &sched[(week - 1) * numEntities];
+            file << ",";
+            for (int entity = 0; entity < numEntities; entity++) {
+                if (matchups[entity] > entity) {
+                    file << (entity > 0 ? "; " : "") << entities[entity]
+                         << " vs. " << entities[matchups[entity]];
+                }
+            }
+        }
+        file << "\n";
+
+        // Only the best ten are kept.
+        if (schedules.size() < 10 || state.score > schedules.back().score) {
+            schedules.push_back(scoreSchedule(state));
+            std::sort(schedules.begin(), schedules.end(), byScore);
+            schedules.resize(std::min<int>(schedules.size(), 10));
         }
+    });
+    file.close();
+
+    std::cout << "Enumerated " << formatScheduleCount(count)
+              << " valid schedules to " << filePath << std::endl;
+
+    for (int i = 0; i < schedules.size(); ++i) {
+        generateOutput(schedules[i], getOutputFilePath(i, schedules[i]));
     }
+
+    return schedules;
 }
 
-// This method schedules a matchup for all entities
-// for the given week.
-void Scheduler::scheduleWeek(int week) {
-    if (week > weeks) {
+// Returns the output path, without extension, of the schedule
+// ranked `rank` (starting at 0).
+std::string Scheduler::getOutputFilePath(
+    int rank,
+    const ScoredSchedule& sched
+) {
+    return outputPath + "/schedule" + createScheduleID(rank) + "-" +
+           std::to_string(sched.score);
+}
+
+// Uses `n` threads to search for each schedule. With more than one
+// thread, a single search tree is split between the threads, or with
+// Luby restarts, each thread runs its own restarting search.
+void Scheduler::setSearchThreads(int n) { searchThreads = std::max(n, 1); }
+
+void Scheduler::setSearchHeuristics(SearchHeuristics h) {
+    heuristics = h;
+    heuristics.restartUnit = std::max(heuristics.restartUnit, 1);
+}
+
+SearchStats Scheduler::getSearchStats() { return stats; }
+
+// Searches week by week over a precomputed table of every possible week
+// of matchups, instead of pairing one entity at a time. The table only
+// fits leagues with an even number of at most 14 entities. The search
+// restarts on the Luby schedule whether or not `lubyRestarts` is set.
+void Scheduler::setMatchingEngine(bool enabled) {
+    if (!enabled) {
+        matchingTable.reset();
+        state.matchingStack.clear();
         return;
-    } else if (scheduleConstraints.contains(week)) {
-        // If the week is determined by schedule constraints,
-        // move to the next week.
-        return scheduleWeek(week + 1);
     }
 
-    // Keep track of which entities have not been
-    // scheduled this week.
-    std::vector<std::string> unscheduledEntities = entities;
+    matchingTable = std::make_unique<MatchingTable>(numEntities);
+    state.matchingStack.assign((weeks + 1) * matchingTable->size(), -1);
+    std::iota(
+        state.matchingStack.begin(),
+        state.matchingStack.begin() + matchingTable->size(),
+        0
+    );
+}
 
-    // Iterate over the entities that do not have a
-    // scheduled matchup this week.
-    while (unscheduledEntities.size() > 0) {
-        std::string entity = unscheduledEntities[0];
-        std::string opponent = getOpponent(week, entity);
+void Scheduler::insertScheduleConstraints(SearchState& s) {
+    for (int i = 0; i < pinnedSchedule.size(); i++) {
+        int week = i / numEntities + 1;
+        int entity = i % numEntities;
+        int opponent = pinnedSchedule[i];
 
-        if (opponent.length() > 0) {
-            alterSchedule(week, entity, opponent, unscheduledEntities);
-        } else {
-            // If there are no possible opponents, we need to
-            // backtrack, since this is a dead-end.
-            int backtrack = 4;
-            int newWeek = std::max(week - backtrack, 1);
-            cleanup(week, newWeek);
-            return scheduleWeek(newWeek);
+        if (opponent > entity) {
+            placeMatchup(s, week, entity, opponent);
+        }
+    }
+}
+
+// This method schedules a matchup for all entities
+// for the given week and every week after it.
+void Scheduler::scheduleWeek(SearchState& s, int week) {
+    while (week <= weeks) {
+        if (pinnedWeeks[week - 1]) {
+            // If the week is determined by schedule constraints,
+            // move to the next week.
+            ++week;
+            continue;
+        }
+
+        // Keep track of which entities have not been
+        // scheduled this week.
+        s.unscheduled.clear();
+        for (int entity = 0; entity < numEntities; entity++) {
+            s.unscheduled.push_back(entity);
+        }
+
+        // Iterate over the entities that do not have a
+        // scheduled matchup this week.
+        int nextWeek = week + 1;
+        while (s.unscheduled.size() > 0) {
+            int entity = selectEntity(s, week);
+            int opponent = getOpponent(s, week, entity);
+
+            if (opponent >= 0) {
+                alterSchedule(s, week, entity, opponent);
+            } else {
+                // If there are no possible opponents, we need to
+                // backtrack, since this is a dead-end.
+                if (addFailure(s)) {
+                    return;
+                }
+
+                int backtrack = 4;
+                nextWeek = std::max(week - backtrack, 1);
+                cleanup(s, week, nextWeek);
+                break;
+            }
         }
 
         // When all entities have a scheduled matchup
         // this week, advance to the next week.
-        if (unscheduledEntities.size() == 0) {
-            return scheduleWeek(week + 1);
-        }
+        week = nextWeek;
+    }
+}
+
+// Counts a dead end of the search in `s`. Returns true once the search
+// should give up: after more than `s.failureLimit` dead ends, or when
+// `createSchedules` has been cancelled or has run out of time. In the
+// latter case the limit is also lowered, so the depth-first searches
+// unwind as they would after too many dead ends.
+bool Scheduler::addFailure(SearchState& s) {
+    ++s.failures;
+    if (s.failures % stopCheckInterval == 0 && isStopped()) {
+        s.failureLimit = 0;
     }
+    return s.failures > s.failureLimit;
 }
 
-// Returns a randomly selected opponent, or None
+// Returns a randomly selected opponent, or -1
 // if there are no valid matchups.
-std::string Scheduler::getOpponent(int week, std::string entity) {
-    std::vector<std::string> possibleOpponents;
+int Scheduler::getOpponent(SearchState& s, int week, int entity) {
+    s.candidates.clear();
+
+    for (int opponent = 0; opponent < numEntities; opponent++) {
+        if (checkMatchup(s, week, entity, opponent)) {
+            s.candidates.push_back(opponent);
+        }
+    }
 
-    for (const auto& opponent : constraints[entity]) {
-        if (checkMatchup(week, entity, opponent.first)) {
-            possibleOpponents.push_back(opponent.first);
+    // With the LCV heuristic, keep only the opponents that
+    // the fewest other entities could play.
+    if (heuristics.leastConstrainingValue && s.candidates.size() > 1) {
+        int fewestOptions = numEntities;
+        for (int opponent : s.candidates) {
+            int options = countOpponents(s, week, opponent, entity);
+            s.opponentOptions[opponent] = options;
+            fewestOptions = std::min(fewestOptions, options);
         }
+        std::erase_if(s.candidates, [&s, fewestOptions](int opponent) {
+            return s.opponentOptions[opponent] > fewestOptions;
+        });
     }
 
+    // Sometimes keep only the opponents that best meet
+    // the scoring criteria.
+    int numPreferred = preferCriteria(
+        s, week, entity, s.candidates.data(), s.candidates.size()
+    );
+    s.candidates.resize(numPreferred);
+
     // Choose a random opponent from the list
     // of possible opponents.
-    if (possibleOpponents.size() > 0) {
-        int index = std::rand() % possibleOpponents.size();
-        return possibleOpponents[index];
+    if (s.candidates.size() > 0) {
+        int index = s.rng() % s.candidates.size();
+        return s.candidates[index];
     } else {
-        return "";
+        return -1;
     }
 }
 
@@ -184,151 +507,1029 @@ std::string Scheduler::getOpponent(int week, std::string entity) {
 // given week and removes both entities from the
 // list of unscheduled entities.
 void Scheduler::alterSchedule(
+    SearchState& s,
     int week,
-    std::string entity,
-    std::string opponent,
-    std::vector<std::string>& unscheduledEntities
+    int entity,
+    int opponent
 ) {
-    schedule[week - 1][entity] = opponent;
-    schedule[week - 1][opponent] = entity;
+    placeMatchup(s, week, entity, opponent);
 
     // Both entity and opponent now have
     // scheduled matchups this week.
-    unscheduledEntities.erase(std::remove(
-        unscheduledEntities.begin(), unscheduledEntities.end(), entity
-    ));
-    unscheduledEntities.erase(std::remove(
-        unscheduledEntities.begin(), unscheduledEntities.end(), opponent
-    ));
+    std::erase(s.unscheduled, entity);
+    std::erase(s.unscheduled, opponent);
+}
+
+// Saves the matchup of entity vs. opponent for the given week.
+void Scheduler::placeMatchup(
+    SearchState& s,
+    int week,
+    int entity,
+    int opponent
+) {
+    s.score += objective.getMatchupDelta(s.schedule, week, entity, opponent);
+    s.schedule[(week - 1) * numEntities + entity] = opponent;
+    s.schedule[(week - 1) * numEntities + opponent] = entity;
 
     // Decrement the number of times entity
     // and opponent need to play each other.
-    --constraints[entity][opponent];
-    --constraints[opponent][entity];
+    --s.remaining[entity * numEntities + opponent];
+    --s.remaining[opponent * numEntities + entity];
+}
+
+// Undoes `placeMatchup`.
+void Scheduler::removeMatchup(
+    SearchState& s,
+    int week,
+    int entity,
+    int opponent
+) {
+    s.schedule[(week - 1) * numEntities + entity] = -1;
+    s.schedule[(week - 1) * numEntities + opponent] = -1;
+    ++s.remaining[entity * numEntities + opponent];
+    ++s.remaining[opponent * numEntities + entity];
+    s.score -= objective.getMatchupDelta(s.schedule, week, entity, opponent);
 }
 
 // When the search hits a dead-end, backtrack.
-void Scheduler::cleanup(int currentWeek, int newWeek) {
+void Scheduler::cleanup(SearchState& s, int currentWeek, int newWeek) {
     // Iterate over the weeks between the new week
     // and the current week, and undo any changes that
-    // have been made to instance variables.
+    // have been made to the search state.
     for (int week = newWeek; week <= currentWeek; week++) {
-        if (scheduleConstraints.contains(week)) {
+        if (pinnedWeeks[week - 1]) {
             // Do not modify weeks that are determined by
             // schedule constraints.
             continue;
         }
 
-        for (const auto& matchup : schedule[week - 1]) {
-            std::string entity = matchup.first;
-            std::string opponent = matchup.second;
+        int* matchups = &s.schedule[(week - 1) * numEntities];
+        for (int entity = 0; entity < numEntities; entity++) {
+            int opponent = matchups[entity];
 
-            if (opponent.length() > 0) {
-                constraints[entity][opponent]++;
-                schedule[week - 1][entity] = "";
+            // Each matchup is stored under both entities; undo
+            // it once, from the entity with the lower index.
+            if (opponent > entity) {
+                removeMatchup(s, week, entity, opponent);
             }
         }
     }
 }
 
-// Checks whether the given matchup is valid.
-bool Scheduler::checkMatchup(
+// The shared state of a search tree split between threads. Each subproblem
+// is a snapshot of a search state, so a worker that takes one only needs
+// to copy it into its own state. With Luby restarts, the tree is not split:
+// each worker searches all of it from `root` with its own random choices
+// and restart schedule, and the first to finish wins. The threads, their
+// states and the snapshots are kept between searches, so restarts and
+// later schedules neither start threads nor allocate.
+struct Scheduler::ParallelSearch {
+    struct Node {
+        CompactSchedule schedule;
+        std::vector<int> remaining;
+        int score;
+        int week;
+        int depth;
+    };
+
+    WorkStealingQueues<Node*> queues;
+    std::vector<SearchState> states;
+    std::vector<std::thread> threads;
+    // Every snapshot is allocated up front by `allocateNodes`, and the ones
+    // not in use are kept in `freeNodes`.
+    std::mutex nodesMutex;
+    std::vector<Node> nodes;
+    std::vector<Node*> freeNodes;
+    // Subproblems that have been queued but not fully explored, and those
+    // still waiting in a queue.
+    std::atomic<long> pending;
+    std::atomic<long> queued;
+    std::atomic<int> idleWorkers;
+    std::atomic<bool> found;
+    bool restarts;
+    Node root;
+    // Set when a restarting worker has searched the whole tree.
+    std::atomic<bool> exhausted;
+    std::atomic<long> numRestarts;
+    const std::atomic<bool>* cancelled;
+    Scheduler* scheduler;
+    // Matchups above this depth are always split into subproblems.
+    int splitDepth;
+    std::mutex resultMutex;
+    SearchState* result;
+    // Idle workers wait on `workQueued` until there is work to steal or the
+    // search is over.
+    std::mutex workMutex;
+    std::condition_variable workQueued;
+    // Threads wait on `searchStarted` between searches, and the searching
+    // thread waits on `searchFinished` until every worker is done.
+    std::mutex searchMutex;
+    std::condition_variable searchStarted;
+    std::condition_variable searchFinished;
+    long generation;
+    int runningWorkers;
+    bool shutdown;
+
+    ParallelSearch(int numWorkers)
+        : queues(numWorkers),
+          pending(0),
+          queued(0),
+          idleWorkers(0),
+          found(false),
+          restarts(false),
+          exhausted(false),
+          numRestarts(0),
+          cancelled(nullptr),
+          scheduler(nullptr),
+          splitDepth(0),
+          result(nullptr),
+          generation(0),
+          runningWorkers(0),
+          shutdown(false) {}
+
+    ~ParallelSearch() {
+        {
+            std::lock_guard<std::mutex> lock(searchMutex);
+            shutdown = true;
+        }
+        searchStarted.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    bool stopped() const {
+        return found || exhausted || (cancelled && cancelled->load()) ||
+               scheduler->isOutOfTime();
+    }
+
+    // Copies `s` to the result, unless another worker got there first.
+    void finish(const SearchState& s) {
+        bool expected = false;
+        if (found.compare_exchange_strong(expected, true)) {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            std::copy(
+                s.schedule.begin(), s.schedule.end(), result->schedule.begin()
+            );
+            std::copy(
+                s.remaining.begin(),
+                s.remaining.end(),
+                result->remaining.begin()
+            );
+            result->score = s.score;
+        }
+    }
+
+    // Allocates `count` snapshots the size of `s`, and room for all of them
+    // in every queue.
+    void allocateNodes(int count, const SearchState& s) {
+        nodes.resize(count);
+        freeNodes.reserve(count);
+        for (Node& node : nodes) {
+            node.schedule = s.schedule;
+            node.remaining = s.remaining;
+            freeNodes.push_back(&node);
+        }
+        queues.reserve(count);
+    }
+
+    // Queues a snapshot of `s`. Returns false, queuing nothing, if every
+    // snapshot is in use.
+    bool push(int worker, const SearchState& s, int week, int depth) {
+        Node* node;
+        {
+            std::lock_guard<std::mutex> lock(nodesMutex);
+            if (freeNodes.empty()) {
+                return false;
+            }
+            node = freeNodes.back();
+            freeNodes.pop_back();
+        }
+        node->schedule.assign(s.schedule.begin(), s.schedule.end());
+        node->remaining.assign(s.remaining.begin(), s.remaining.end());
+        node->score = s.score;
+        node->week = week;
+        node->depth = depth;
+
+        ++pending;
+        queues.push(worker, node);
+        ++queued;
+        if (idleWorkers > 0) {
+            wake(false);
+        }
+        return true;
+    }
+
+    void release(Node* node) {
+        std::lock_guard<std::mutex> lock(nodesMutex);
+        freeNodes.push_back(node);
+    }
+
+    // Taking the mutex before notifying keeps a worker from missing the
+    // wakeup between checking for work and starting to wait.
+    void wake(bool all) {
+        { std::lock_guard<std::mutex> lock(workMutex); }
+        if (all) {
+            workQueued.notify_all();
+        } else {
+            workQueued.notify_one();
+        }
+    }
+
+    // Runs the worker `worker` once per search until shut down.
+    void run(int worker) {
+        long seen = 0;
+        std::unique_lock<std::mutex> lock(searchMutex);
+        while (true) {
+            searchStarted.wait(lock, [&] {
+                return shutdown || generation != seen;
+            });
+            if (shutdown) {
+                return;
+            }
+            seen = generation;
+
+            lock.unlock();
+            scheduler->searchWorker(*this, worker);
+            lock.lock();
+
+            if (--runningWorkers == 0) {
+                searchFinished.notify_one();
+            }
+        }
+    }
+};
+
+Scheduler::Scheduler(Scheduler&& other) = default;
+
+Scheduler::~Scheduler() = default;
+
+// Searches for a valid schedule extending `s` on `searchThreads`
+// threads. With Luby restarts, every thread runs its own restarting
+// search. Otherwise the first week to schedule is split into subproblems
+// up front, and busy threads hand off unexplored branches whenever a
+// thread is idle. Returns false if the search was cancelled or ran out
+// of time.
+bool Scheduler::searchParallel(
+    SearchState& s,
+    const std::atomic<bool>* cancelled
+) {
+    if (!parallelSearch || parallelSearch->threads.size() != searchThreads) {
+        parallelSearch.reset();
+        parallelSearch = std::make_unique<ParallelSearch>(searchThreads);
+        // Splitting the first two levels takes at most 1 + n + n^2
+        // snapshots, and each handoff at most n - 1, so this is enough for
+        // every worker to hand off once at each depth at the same time.
+        // Should the pool still run out, the branches are searched by the
+        // thread that has them instead.
+        int maxDepth = weeks * numEntities / 2;
+        parallelSearch->allocateNodes(
+            1 + numEntities + numEntities * numEntities +
+                searchThreads * maxDepth * numEntities,
+            s
+        );
+        for (int i = 0; i < searchThreads; i++) {
+            parallelSearch->states.push_back(s);
+            parallelSearch->states[i].rng.seed(s.rng() + i);
+        }
+        for (int i = 0; i < searchThreads; i++) {
+            parallelSearch->threads.emplace_back(
+                &ParallelSearch::run, parallelSearch.get(), i
+            );
+        }
+    }
+
+    ParallelSearch& search = *parallelSearch;
+    search.found = false;
+    search.restarts = heuristics.lubyRestarts;
+    search.exhausted = false;
+    search.numRestarts = 0;
+    search.cancelled = cancelled;
+    search.scheduler = this;
+    search.splitDepth = 2;
+    search.result = &s;
+    for (auto& workerState : search.states) {
+        workerState.failures = 0;
+        workerState.failureLimit = std::numeric_limits<long>::max();
+    }
+
+    if (search.restarts) {
+        search.root.schedule.assign(s.schedule.begin(), s.schedule.end());
+        search.root.remaining.assign(s.remaining.begin(), s.remaining.end());
+        search.root.score = s.score;
+    } else {
+        search.push(0, s, 1, 0);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(search.searchMutex);
+        search.runningWorkers = searchThreads;
+        ++search.generation;
+        search.searchStarted.notify_all();
+        search.searchFinished.wait(lock, [&search] {
+            return search.runningWorkers == 0;
+        });
+    }
+
+    // A stopped search can leave subproblems behind.
+    ParallelSearch::Node* node;
+    while (search.queues.pop(0, node)) {
+        search.release(node);
+    }
+    search.pending = 0;
+    search.queued = 0;
+
+    for (const auto& workerState : search.states) {
+        stats.failures += workerState.failures;
+    }
+    stats.restarts += search.numRestarts;
+
+    if (!search.found && !(cancelled && cancelled->load()) &&
+        !isOutOfTime()) {
+        throw std::runtime_error(
+            "No schedule satisfies the given constraints."
+        );
+    }
+
+    return search.found;
+}
+
+void Scheduler::searchWorker(ParallelSearch& search, int worker) {
+    SearchState& s = search.states[worker];
+    if (search.restarts) {
+        // Like `searchWithRestarts`, except that the dead ends of every
+        // restart add up in `s.failures` for the statistics.
+        for (long restart = 1; !search.stopped(); restart++) {
+            const ParallelSearch::Node& root = search.root;
+            std::copy(
+                root.schedule.begin(), root.schedule.end(), s.schedule.begin()
+            );
+            std::copy(
+                root.remaining.begin(),
+                root.remaining.end(),
+                s.remaining.begin()
+            );
+            s.score = root.score;
+            s.failureLimit =
+                s.failures + luby(restart) * heuristics.restartUnit;
+
+            if (searchMatchups(s, 1, 0, &search, worker)) {
+                search.finish(s);
+                return;
+            }
+            if (search.stopped()) {
+                return;
+            }
+            if (s.failures <= s.failureLimit) {
+                search.exhausted = true;
+                return;
+            }
+            ++search.numRestarts;
+        }
+        return;
+    }
+
+    ParallelSearch::Node* node;
+
+    while (!search.stopped()) {
+        if (!search.queues.pop(worker, node)) {
+            if (search.pending == 0) {
+                break;
+            }
+
+            ++search.idleWorkers;
+            {
+                std::unique_lock<std::mutex> lock(search.workMutex);
+                search.workQueued.wait(lock, [&search] {
+                    return search.queued > 0 || search.pending == 0 ||
+                           search.stopped();
+                });
+            }
+            --search.idleWorkers;
+            continue;
+        }
+        --search.queued;
+
+        std::copy(
+            node->schedule.begin(), node->schedule.end(), s.schedule.begin()
+        );
+        std::copy(
+            node->remaining.begin(),
+            node->remaining.end(),
+            s.remaining.begin()
+        );
+        s.score = node->score;
+        int week = node->week;
+        int depth = node->depth;
+        search.release(node);
+
+        if (searchMatchups(s, week, depth, &search, worker)) {
+            search.finish(s);
+        }
+
+        if (--search.pending == 0) {
+            search.wake(true);
+        }
+    }
+
+    // Idle workers only poll for the end of the search when woken.
+    search.wake(true);
+}
+
+// Depth-first search over the unscheduled matchups. `depth` counts the
+// matchups placed by the search so far. When `search` is given, the search
+// stops with it, and unless its workers restart, branches are split off
+// for other threads onto `worker`'s queue. The search gives up once it has
+// hit more than `s.failureLimit` dead ends. Returns true once `s` holds a
+// valid schedule.
+bool Scheduler::searchMatchups(
+    SearchState& s,
     int week,
-    std::string entity,
-    std::string opponent
+    int depth,
+    ParallelSearch* search,
+    int worker
 ) {
-    // Avoid scheduling an entity against itself.
-    if (entity.compare(opponent) == 0) {
+    if (search && search->stopped()) {
         return false;
     }
 
-    // Check if any matchups remain between entity
-    // and opponent.
-    if (constraints[entity][opponent] <= 0) {
-        return false;
+    // Find the next entity to schedule, starting from `week`.
+    int firstWeek = week;
+    int entity = -1;
+    for (; week <= weeks; week++) {
+        if (pinnedWeeks[week - 1]) continue;
+
+        entity = selectEntity(s, week);
+        if (entity >= 0) break;
     }
 
-    // Check if opponent already has a scheduled matchup
-    // this week.
-    if (schedule[week - 1][opponent] != "") {
+    if (entity < 0) {
+        return validateSchedule(s);
+    }
+
+    // At the start of a week, skip states already known to be dead ends.
+    // Threads do not share the store, so only a single thread uses it.
+    bool weekStart = !search && nogoods && (week > firstWeek || depth == 0);
+    NogoodKey key;
+    if (weekStart) {
+        key = getNogoodKey(s, week);
+        ++stats.nogoodLookups;
+        if (nogoods->contains(key)) {
+            ++stats.nogoodHits;
+            addFailure(s);
+            return false;
+        }
+    }
+
+    int* candidates = &s.candidateStack[depth * numEntities];
+    int numCandidates = 0;
+    for (int opponent = 0; opponent < numEntities; opponent++) {
+        if (checkMatchup(s, week, entity, opponent)) {
+            candidates[numCandidates++] = opponent;
+        }
+    }
+    orderOpponents(s, week, entity, candidates, numCandidates);
+
+    if (numCandidates == 0) {
+        addFailure(s);
+        if (weekStart) {
+            nogoods->insert(key);
+        }
         return false;
     }
 
-    // Check whether entity and opponent play during the
-    // previous `self.weeksBetweenMatchups` weeks or the
-    // next `self.weeksBetweenMatchups` weeks.
-    int startIndex = std::max(week - 1 - weeksBetweenMatchups, 0);
-    int endIndex = std::min(week - 1 + weeksBetweenMatchups, weeks - 1);
-    for (int i = startIndex; i <= endIndex; i++) {
-        if (schedule[i][entity].compare(opponent) == 0) {
+    bool split = search && !search->restarts;
+    for (int i = 0; i < numCandidates; i++) {
+        int opponent = candidates[i];
+        placeMatchup(s, week, entity, opponent);
+
+        bool queued = false;
+        if (split && depth < search->splitDepth) {
+            // Near the root, every branch becomes a subproblem.
+            queued = search->push(worker, s, week, depth + 1);
+        } else if (split && search->idleWorkers > 0 &&
+                   i + 1 < numCandidates) {
+            // Another thread is waiting for work, so hand it the
+            // branches this thread has not explored yet, last first.
+            removeMatchup(s, week, entity, opponent);
+            while (numCandidates > i + 1) {
+                int other = candidates[numCandidates - 1];
+                placeMatchup(s, week, entity, other);
+                bool pushed = search->push(worker, s, week, depth + 1);
+                removeMatchup(s, week, entity, other);
+                if (!pushed) {
+                    break;
+                }
+                --numCandidates;
+            }
+            placeMatchup(s, week, entity, opponent);
+        }
+
+        if (!queued && searchMatchups(s, week, depth + 1, search, worker)) {
+            return true;
+        }
+
+        removeMatchup(s, week, entity, opponent);
+
+        if (s.failures > s.failureLimit) {
             return false;
         }
     }
 
-    return true;
+    // Every branch was explored without finding a schedule, so the state
+    // has no valid completion.
+    if (weekStart) {
+        nogoods->insert(key);
+    }
+    return false;
 }
 
-// Checks whether the created schedule meets the given constraints.
-bool Scheduler::validateSchedule() {
-    MatchupConstraints testConstraints;
+// Depth-first search over whole weeks. Each week is filled with one
+// matching from the table whose pairs are all still owed and none of
+// which play within `weeksBetweenMatchups` weeks, both checked with
+// bitmasks. Owed matchups only run out deeper in the search, so the
+// matchings still owed are narrowed from the `numOwed` ones in `owed`,
+// those of the week before, rather than from the whole table. Candidate
+// matchings are tried in a random order. The search gives up once it has
+// hit more than `s.failureLimit` dead ends. Returns true once `s` holds a
+// valid schedule.
+bool Scheduler::searchMatchings(
+    SearchState& s,
+    int week,
+    const int* owed,
+    int numOwed
+) {
+    while (week <= weeks && pinnedWeeks[week - 1]) {
+        ++week;
+    }
+    if (week > weeks) {
+        return validateSchedule(s);
+    }
+
+    // Skip states already known to be dead ends.
+    NogoodKey key;
+    if (nogoods) {
+        key = getNogoodKey(s, week);
+        ++stats.nogoodLookups;
+        if (nogoods->contains(key)) {
+            ++stats.nogoodHits;
+            addFailure(s);
+            return false;
+        }
+    }
 
-    // Check whether the schedule length differs from the requested
-    // number of weeks.
-    if (schedule.size() != weeks) {
+    if (!canComplete(s, week)) {
+        addFailure(s);
+        if (nogoods) {
+            nogoods->insert(key);
+        }
         return false;
     }
 
-    for (int week = 1; week <= weeks; week++) {
-        for (const auto& matchup : schedule[week - 1]) {
-            std::string entity = matchup.first;
-            std::string opponent = matchup.second;
-
-            // Keep track of how many times each entity is
-            // matched up against each of the other entities.
-            testConstraints[entity][opponent] += 1;
-
-            // Check whether any matchup pair exists more than once
-            // in any `self.weeksBetweenMatchups + 1` week span.
-            int startIndex = std::max(week - 1 - weeksBetweenMatchups, 0);
-            int endIndex = std::min(week - 1 - weeksBetweenMatchups, weeks - 1);
-            for (int i = startIndex; i <= endIndex; i++) {
-                if (schedule[i][entity].compare(opponent) == 0) {
-                    return false;
-                }
+    // Collect the pairs that are no longer owed, and those that cannot
+    // play this week because they play too close to it.
+    PairMask played;
+    for (int entity = 0; entity < numEntities; entity++) {
+        for (int opponent = entity + 1; opponent < numEntities; opponent++) {
+            if (s.remaining[entity * numEntities + opponent] <= 0) {
+                played.set(matchingTable->getPairIndex(entity, opponent));
+            }
+        }
+    }
+
+    PairMask nearby;
+    int startWeek = std::max(week - weeksBetweenMatchups, 1);
+    int endWeek = std::min(week + weeksBetweenMatchups, weeks);
+    for (int w = startWeek; w <= endWeek; w++) {
+        const int* matchups = &s.schedule[(w - 1) * numEntities];
+        for (int entity = 0; entity < numEntities; entity++) {
+            if (matchups[entity] > entity) {
+                nearby.set(
+                    matchingTable->getPairIndex(entity, matchups[entity])
+                );
             }
         }
     }
 
-    // Check whether each entity is matched up against each of
-    // the other entities the correct number of times.
-    for (const auto& e : testConstraints) {
-        std::string entity = e.first;
+    // Keep the matchings still owed for the weeks after this one, with
+    // the candidates for this week moved to the front.
+    int* matchings = &s.matchingStack[week * matchingTable->size()];
+    int numMatchings = 0;
+    int numCandidates = 0;
+    for (int i = 0; i < numOwed; i++) {
+        const PairMask& mask = matchingTable->getMask(owed[i]);
+        if ((mask & played).any()) continue;
+
+        matchings[numMatchings++] = owed[i];
+        if ((mask & nearby).none()) {
+            std::swap(matchings[numCandidates++], matchings[numMatchings - 1]);
+        }
+    }
+
+    if (numCandidates == 0) {
+        addFailure(s);
+        if (nogoods) {
+            nogoods->insert(key);
+        }
+        return false;
+    }
 
-        for (const auto& c : e.second) {
-            std::string opponent = c.first;
-            int numMatchups = c.second;
+    for (int i = 0; i < numCandidates; i++) {
+        // Shuffle lazily, since most searches only try a few candidates.
+        int j = i + s.rng() % (numCandidates - i);
+        std::swap(matchings[i], matchings[j]);
 
-            if (numMatchups != constraintsCheck[entity][opponent]) {
-                return false;
+        const std::int8_t* partners = matchingTable->getPartners(matchings[i]);
+        for (int entity = 0; entity < numEntities; entity++) {
+            if (partners[entity] > entity) {
+                placeMatchup(s, week, entity, partners[entity]);
+            }
+        }
+
+        if (searchMatchings(s, week + 1, matchings, numMatchings)) {
+            return true;
+        }
+
+        for (int entity = 0; entity < numEntities; entity++) {
+            if (partners[entity] > entity) {
+                removeMatchup(s, week, entity, partners[entity]);
+            }
+        }
+
+        if (s.failures > s.failureLimit) {
+            return false;
+        }
+    }
+
+    // Every matching was tried without finding a schedule, so the state
+    // has no valid completion.
+    if (nogoods) {
+        nogoods->insert(key);
+    }
+    return false;
+}
+
+// Forward checking for `searchMatchings`, with every week before `week`
+// filled. Each entity plays once in every unpinned week from `week` on,
+// and a pair can play at most once every `weeksBetweenMatchups + 1` weeks
+// after its last matchup. Returns false if some entity is owed too few
+// matchups that fit to play every week, or if some pair that plays at all
+// can no longer fit the matchups it still owes.
+bool Scheduler::canComplete(SearchState& s, int week) {
+    std::fill(s.lastMatchupWeeks.begin(), s.lastMatchupWeeks.end(), 0);
+    for (int w = 1; w < week; w++) {
+        const int* matchups = &s.schedule[(w - 1) * numEntities];
+        for (int entity = 0; entity < numEntities; entity++) {
+            if (matchups[entity] >= 0) {
+                s.lastMatchupWeeks[entity * numEntities + matchups[entity]] = w;
             }
         }
     }
 
-    // Check that any schedule constraints are met.
-    for (auto [week, matchups] : scheduleConstraints) {
-        for (auto [entity, opponent] : matchups) {
-            if (schedule[week - 1][entity] != opponent) {
+    int weeksLeft = 0;
+    for (int w = week; w <= weeks; w++) {
+        weeksLeft += !pinnedWeeks[w - 1];
+    }
+
+    for (int entity = 0; entity < numEntities; entity++) {
+        int fits = 0;
+        for (int opponent = 0; opponent < numEntities; opponent++) {
+            int pair = entity * numEntities + opponent;
+            int remaining = s.remaining[pair];
+            if (remaining <= 0) continue;
+
+            const int spacing = weeksBetweenMatchups + 1;
+            int lastWeek = s.lastMatchupWeeks[pair];
+            int firstWeek = lastWeek > 0 ? std::max(week, lastWeek + spacing)
+                                         : week;
+            int slots =
+                firstWeek <= weeks ? (weeks - firstWeek) / spacing + 1 : 0;
+
+            if (remaining < owedMatchups[pair] && remaining > slots) {
                 return false;
             }
+            fits += std::min(remaining, slots);
+        }
+
+        if (fits < weeksLeft) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Searches for a valid schedule extending `s` on a single thread,
+// restarting the search from `s` whenever it hits too many dead ends. The
+// number of dead ends allowed before each restart follows the Luby
+// sequence, scaled by `heuristics.restartUnit`. Returns false if the
+// search was cancelled or ran out of time.
+bool Scheduler::searchWithRestarts(
+    SearchState& s,
+    const std::atomic<bool>* cancelled
+) {
+    for (long restart = 1;; restart++) {
+        s.failures = 0;
+        s.failureLimit = luby(restart) * heuristics.restartUnit;
+
+        // The first block of the matching stack lists every matching.
+        bool found = matchingTable ? searchMatchings(
+                                         s,
+                                         1,
+                                         s.matchingStack.data(),
+                                         matchingTable->size()
+                                     )
+                                   : searchMatchups(s, 1, 0, nullptr, 0);
+        stats.failures += s.failures;
+        if (found) {
+            return true;
+        }
+
+        if (s.failures <= s.failureLimit) {
+            throw std::runtime_error(
+                "No schedule satisfies the given constraints."
+            );
+        }
+
+        ++stats.restarts;
+        if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (isOutOfTime()) {
+            return false;
+        }
+    }
+}
+
+// Stops `createSchedules` after the given number of seconds. A budget of
+// zero means no limit.
+void Scheduler::setTimeBudget(double seconds) { timeBudget = seconds; }
+
+// Whether `createSchedules` has been cancelled or has run out of time.
+bool Scheduler::isStopped() const {
+    return (cancelFlag && cancelFlag->load(std::memory_order_relaxed)) ||
+           isOutOfTime();
+}
+
+bool Scheduler::isOutOfTime() const {
+    if (timeBudget <= 0) {
+        return false;
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+    return elapsed.count() >= timeBudget;
+}
+
+// Makes the search choose an opponent that best meets the scoring
+// criteria with probability `p`, whenever the entity has criteria that
+// week. Otherwise opponents are chosen as usual, so the search still
+// finds a variety of schedules.
+void Scheduler::setCriteriaBias(double p) {
+    criteriaBias = std::clamp(p, 0.0, 1.0);
+}
+
+// Remembers up to `n` search states that cannot be completed, so the
+// depth-first searches can prune them as soon as they reach them again,
+// whether after backtracking, after a restart or in a later attempt. A
+// size of zero turns the store off.
+void Scheduler::setNogoodCacheSize(int n) {
+    if (n <= 0) {
+        nogoods.reset();
+        return;
+    }
+
+    nogoods = std::make_unique<NogoodStore>(n);
+}
+
+// Fingerprints a search state that is about to fill `week`: the matchups
+// still owed, and the matchups of the weeks recent enough to rule out
+// repeats in the weeks to come. Every earlier week is complete and later
+// weeks only hold pinned matchups, so nothing else decides whether the
+// schedule can be finished.
+NogoodKey Scheduler::getNogoodKey(const SearchState& s, int week) const {
+    NogoodKey key;
+    key.add(week);
+
+    for (int entity = 0; entity < numEntities; entity++) {
+        for (int opponent = entity + 1; opponent < numEntities; opponent++) {
+            key.add(s.remaining[entity * numEntities + opponent]);
+        }
+    }
+
+    int startWeek = std::max(week - weeksBetweenMatchups, 1);
+    for (int i = (startWeek - 1) * numEntities; i < (week - 1) * numEntities;
+         i++) {
+        key.add(s.schedule[i]);
+    }
+
+    return key;
+}
+
+// Returns the `i`th term (starting at 1) of the Luby sequence:
+// 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ...
+long Scheduler::luby(long i) {
+    long power = 1;
+    while (power * 2 - 1 < i) {
+        power *= 2;
+    }
+
+    if (power * 2 - 1 == i) {
+        return power;
+    }
+    return luby(i - power + 1);
+}
+
+// Picks the next entity without a matchup in the given week, or returns
+// -1 if every entity has one. By default this is the entity with the
+// lowest index. With the MRV heuristic it is the entity with the fewest
+// possible opponents, and ties go to the entity owed the most matchups.
+int Scheduler::selectEntity(const SearchState& s, int week) const {
+    const int* matchups = &s.schedule[(week - 1) * numEntities];
+    int selected = -1;
+    int fewestOptions = 0;
+    int mostOwed = 0;
+
+    for (int entity = 0; entity < numEntities; entity++) {
+        if (matchups[entity] >= 0) continue;
+
+        if (!heuristics.minimumRemainingValues) {
+            return entity;
+        }
+
+        int options = countOpponents(s, week, entity, -1);
+        int owed = 0;
+        for (int opponent = 0; opponent < numEntities; opponent++) {
+            owed += s.remaining[entity * numEntities + opponent];
+        }
+
+        if (selected < 0 || options < fewestOptions ||
+            (options == fewestOptions && owed > mostOwed)) {
+            selected = entity;
+            fewestOptions = options;
+            mostOwed = owed;
+        }
+    }
+
+    return selected;
+}
+
+// Returns how many entities other than `excluded` could play `entity`
+// in the given week.
+int Scheduler::countOpponents(
+    const SearchState& s,
+    int week,
+    int entity,
+    int excluded
+) const {
+    int count = 0;
+    for (int opponent = 0; opponent < numEntities; opponent++) {
+        if (opponent != excluded && checkMatchup(s, week, entity, opponent)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Shuffles the possible opponents of entity. With the LCV heuristic,
+// they are then ordered so that opponents that the fewest other
+// entities could play come first, leaving the most options open for
+// the rest of the week.
+void Scheduler::orderOpponents(
+    SearchState& s,
+    int week,
+    int entity,
+    int* candidates,
+    int numCandidates
+) {
+    std::shuffle(candidates, candidates + numCandidates, s.rng);
+    if (heuristics.leastConstrainingValue) {
+        int* options = s.opponentOptions.data();
+        for (int i = 0; i < numCandidates; i++) {
+            options[candidates[i]] =
+                countOpponents(s, week, candidates[i], entity);
+        }
+
+        // Insertion sort keeps the shuffled order between ties and,
+        // unlike std::stable_sort, never allocates.
+        for (int i = 1; i < numCandidates; i++) {
+            int candidate = candidates[i];
+            int j = i;
+            while (j > 0 && options[candidates[j - 1]] > options[candidate]) {
+                candidates[j] = candidates[j - 1];
+                --j;
+            }
+            candidates[j] = candidate;
+        }
+    }
+
+    preferCriteria(s, week, entity, candidates, numCandidates);
+}
+
+// With probability `criteriaBias`, moves the candidates whose matchup
+// with `entity` scores highest in `week` to the front, keeping the order
+// within both groups. Returns the number of candidates at the front, or
+// `numCandidates` if none were preferred. Only entity-weeks with scoring
+// criteria are considered, so the random draw is skipped for the rest.
+int Scheduler::preferCriteria(
+    SearchState& s,
+    int week,
+    int entity,
+    int* candidates,
+    int numCandidates
+) {
+    if (criteriaBias <= 0 || numCandidates < 2 ||
+        !criteriaIndex[(week - 1) * numEntities + entity]) {
+        return numCandidates;
+    }
+    if (std::uniform_real_distribution<double>(0, 1)(s.rng) >= criteriaBias) {
+        return numCandidates;
+    }
+
+    int bestWeight = std::numeric_limits<int>::min();
+    for (int i = 0; i < numCandidates; i++) {
+        bestWeight = std::max(
+            bestWeight, objective.getMatchupWeight(week, entity, candidates[i])
+        );
+    }
+
+    int numPreferred = 0;
+    for (int i = 0; i < numCandidates; i++) {
+        int candidate = candidates[i];
+        if (objective.getMatchupWeight(week, entity, candidate) < bestWeight) {
+            continue;
+        }
+
+        for (int j = i; j > numPreferred; j--) {
+            candidates[j] = candidates[j - 1];
+        }
+        candidates[numPreferred++] = candidate;
+    }
+
+    return numPreferred;
+}
+
+// Checks whether the given matchup is valid.
+bool Scheduler::checkMatchup(
+    const SearchState& s,
+    int week,
+    int entity,
+    int opponent
+) const {
+    // Avoid scheduling an entity against itself.
+    if (entity == opponent) {
+        return false;
+    }
+
+    // Check if any matchups remain between entity
+    // and opponent.
+    if (s.remaining[entity * numEntities + opponent] <= 0) {
+        return false;
+    }
+
+    // Check if opponent already has a scheduled matchup
+    // this week.
+    if (s.schedule[(week - 1) * numEntities + opponent] >= 0) {
+        return false;
+    }
+
+    // Check whether entity and opponent play during the
+    // previous `weeksBetweenMatchups` weeks or the
+    // next `weeksBetweenMatchups` weeks.
+    int startIndex = std::max(week - 1 - weeksBetweenMatchups, 0);
+    int endIndex = std::min(week - 1 + weeksBetweenMatchups, weeks - 1);
+    for (int i = startIndex; i <= endIndex; i++) {
+        if (s.schedule[i * numEntities + entity] == opponent) {
+            return false;
         }
     }
 
     return true;
 }
 
+// Checks whether the created schedule meets the given constraints.
+bool Scheduler::validateSchedule(SearchState& s) {
+    Violation violation =
+        validator->validate(s.schedule, s.matchupCounts, s.lastMatchupWeeks);
+    return violation.type == ViolationType::None;
+}
+
+void Scheduler::printViolation(const Violation& violation) {
+    std::cout << "Not a valid schedule: " << getViolationName(violation.type);
+    if (violation.week > 0) {
+        std::cout << " in week " << violation.week;
+    }
+    if (violation.entity >= 0) {
+        std::cout << " for " << entities[violation.entity];
+    }
+    if (violation.opponent >= 0 && violation.opponent < numEntities) {
+        std::cout << " vs. " << entities[violation.opponent];
+    }
+    std::cout << std::endl;
+}
+
 void Scheduler::generateOutput(ScoredSchedule& sched, std::string filePath) {
     generateCsv(sched, filePath);
-    // generatePdf(filePath);
+    // generatePdf(sched, filePath);
 }
 
 void Scheduler::generateCsv(ScoredSchedule& sched, std::string filePath) {
@@ -336,9 +1537,9 @@ void Scheduler::generateCsv(ScoredSchedule& sched, std::string filePath) {
 
     file << "Score: " << sched.score << "\n";
     file << "Matched Criteria:" << "\n";
-    for (auto [week, entity1, entity2] : sched.matchedCriteria) {
+    for (auto [week, entity1, entity2, weight] : sched.matchedCriteria) {
         file << "\tWeek " << week << "\t" << entity1 << " vs. " << entity2
-             << "\n";
+             << "\t" << weight << "\n";
     }
     file << "\n";
 
@@ -350,8 +1551,9 @@ void Scheduler::generateCsv(ScoredSchedule& sched, std::string filePath) {
 
     for (int week = 1; week <= weeks; week++) {
         file << week;
-        for (const auto& entity : entities) {
-            file << "," << sched.schedule[week - 1][entity];
+        for (int entity = 0; entity < numEntities; entity++) {
+            int opponent = sched.schedule[(week - 1) * numEntities + entity];
+            file << "," << entities[opponent];
         }
         file << "\n";
     }
@@ -359,7 +1561,7 @@ void Scheduler::generateCsv(ScoredSchedule& sched, std::string filePath) {
     file.close();
 }
 
-void Scheduler::generatePdf(std::string filePath) {
+void Scheduler::generatePdf(ScoredSchedule& sched, std::string filePath) {
     std::string columnWidth =
         std::to_string(std::floor(100 / (entities.size() + 1)));
 
@@ -374,8 +1576,9 @@ void Scheduler::generatePdf(std::string filePath) {
     for (int week = 1; week <= weeks; week++) {
         tableHtml += "<tr><td>" + std::to_string(week) + "</td>";
 
-        for (const auto& entity : entities) {
-            tableHtml += "<td>" + schedule[week - 1][entity] + "</td>";
+        for (int entity = 0; entity < numEntities; entity++) {
+            int opponent = sched.schedule[(week - 1) * numEntities + entity];
+            tableHtml += "<td>" + entities[opponent] + "</td>";
         }
 
         tableHtml += "</tr>";
@@ -422,27 +1625,101 @@ void Scheduler::generatePdf(std::string filePath) {
     system("rm schedule.html");
 }
 
+// Reads the scoring criteria file. A line holding a week number starts
+// the criteria for that week, and each following `Team1|Team2` line
+// scores a matchup in that week. A `|weight` suffix gives the matchup a
+// weight other than 1, and a leading `!` makes it a penalty for playing
+// that week instead. A `rivalry N` line starts matchups that score in
+// each of the final N weeks, and a `spread W` line sets the bonus per
+// week of separation between rematches.
 void Scheduler::loadScoringCriteria(std::string scoringCriteriaPath) {
     std::ifstream scoringCriteriaFile(scoringCriteriaPath);
+    criteriaIndex.assign(weeks * numEntities, false);
 
     int week = 0;  // Weeks start at 1
+    int rivalryWeeks = 0;
     std::string line;
     while (std::getline(scoringCriteriaFile, line, '\n')) {
         if (line.size() > 0) {
             int delimiterIndex = line.find("|");
 
             if (delimiterIndex < 0) {
-                // This line is a week number.
-                week = stoi(line);
+                std::istringstream header(line);
+                std::string keyword;
+                header >> keyword;
+
+                week = 0;
+                rivalryWeeks = 0;
+                if (keyword == "spread") {
+                    int weight = 0;
+                    header >> weight;
+                    objective.setRematchSpreadWeight(weight);
+                } else if (keyword == "rivalry") {
+                    header >> rivalryWeeks;
+                    rivalryWeeks = std::min(rivalryWeeks, weeks);
+                } else {
+                    // This line is a week number.
+                    week = stoi(line);
+                    if (week > weeks) {
+                        throw std::invalid_argument(
+                            std::string(
+                                "Error reading scoring criteria file: "
+                            ) +
+                            "a criterion was provided for week " + line +
+                            " but the season is " + std::to_string(weeks) +
+                            " weeks long."
+                        );
+                    }
+                }
             } else {
-                // This line is a matchup, e.g., Team1|Team2.
-                std::string entity = line.substr(0, delimiterIndex);
+                // This line is a matchup, e.g., Team1|Team2|2.
+                bool penalty = line[0] == '!';
+                std::string entity =
+                    line.substr(penalty, delimiterIndex - penalty);
                 std::string opponent = line.substr(delimiterIndex + 1);
 
-                // TODO: Check that `entity` and `opponent` are valid entities.
+                int weight = 1;
+                int weightIndex = opponent.find("|");
+                if (weightIndex >= 0) {
+                    weight = stoi(opponent.substr(weightIndex + 1));
+                    opponent = opponent.substr(0, weightIndex);
+                }
+                if (penalty) {
+                    weight = -weight;
+                }
+
+                if (!entityIndex.contains(entity) ||
+                    !entityIndex.contains(opponent)) {
+                    throw std::invalid_argument(
+                        std::string("Error reading scoring criteria file: ") +
+                        entity + " vs. " + opponent +
+                        " is not a matchup between known entities."
+                    );
+                }
 
-                if (week > 0) {
-                    scoringCriteria.emplace_back(week, entity, opponent);
+                int firstWeek = week;
+                int lastWeek = week;
+                if (rivalryWeeks > 0) {
+                    firstWeek = weeks - rivalryWeeks + 1;
+                    lastWeek = weeks;
+                }
+
+                if (firstWeek > 0) {
+                    for (int w = firstWeek; w <= lastWeek; w++) {
+                        scoringCriteria.emplace_back(
+                            w, entity, opponent, weight
+                        );
+                        objective.addMatchupWeight(
+                            w,
+                            entityIndex[entity],
+                            entityIndex[opponent],
+                            weight
+                        );
+                        criteriaIndex[(w - 1) * numEntities +
+                                      entityIndex[entity]] = true;
+                        criteriaIndex[(w - 1) * numEntities +
+                                      entityIndex[opponent]] = true;
+                    }
                 } else {
                     throw std::invalid_argument(
                         std::string(
@@ -459,25 +1736,35 @@ void Scheduler::loadScoringCriteria(std::string scoringCriteriaPath) {
     scoringCriteriaFile.close();
 }
 
-ScoredSchedule Scheduler::scoreSchedule(Schedule& sched) {
-    int score = 0;
-    Criteria matchedCriteria;
+ScoredSchedule Scheduler::scoreSchedule(const SearchState& s) {
+#ifdef CHECK_SCORES
+    // The score is maintained incrementally during the search; the
+    // full evaluation is only a consistency check.
+    if (s.score != objective.evaluate(s.schedule)) {
+        throw std::logic_error(
+            "The incremental score does not match the full evaluation."
+        );
+    }
+#endif
 
-    for (auto [week, entity1, entity2] : scoringCriteria) {
-        if (sched[week - 1][entity1] == entity2) {
-            ++score;
-            matchedCriteria.emplace_back(week, entity1, entity2);
+    Criteria matchedCriteria;
+    for (const auto& criterion : scoringCriteria) {
+        int entity = entityIndex.at(criterion.entity1);
+        int opponent = entityIndex.at(criterion.entity2);
+        if (s.schedule[(criterion.week - 1) * numEntities + entity] ==
+            opponent) {
+            matchedCriteria.push_back(criterion);
         }
     }
 
-    return ScoredSchedule{sched, score, matchedCriteria};
+    return ScoredSchedule{s.schedule, s.score, matchedCriteria};
 }
 
 void Scheduler::printScoring(ScoredSchedule& schedule) {
     std::cout << "Score: " << schedule.score << std::endl;
     std::cout << "Matched Criteria:" << std::endl;
-    for (auto [week, entity1, entity2] : schedule.matchedCriteria) {
+    for (auto [week, entity1, entity2, weight] : schedule.matchedCriteria) {
         std::cout << "\tWeek " << week << "\t" << entity1 << "\t" << entity2
-                  << std::endl;
+                  << "\t" << weight << std::endl;
     }
 }
@@ -1,21 +1,33 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "counter.h"
+#include "matching_table.h"
+#include "nogood_store.h"
+#include "objective.h"
+#include "validator.h"
+
 struct Matchup {
     int week;
     std::string entity1;
     std::string entity2;
+    int weight;
 
-    Matchup(int w, std::string e1, std::string e2)
-        : week(w), entity1(e1), entity2(e2) {}
+    Matchup(int w, std::string e1, std::string e2, int wt = 1)
+        : week(w), entity1(e1), entity2(e2), weight(wt) {}
 };
 
 template <typename K, typename V>
@@ -28,12 +40,78 @@ typedef std::unordered_map<std::string, std::string> Matchups;
 typedef std::vector<Matchup> Criteria;
 typedef std::vector<Matchups> Schedule;
 
+// A schedule stored as a flat weeks x entities array. The value at
+// `(week - 1) * numEntities + entity` is the index of the entity's
+// opponent that week, or -1 if no matchup is scheduled.
+typedef std::vector<int> CompactSchedule;
+
 struct ScoredSchedule {
-    Schedule schedule;
+    CompactSchedule schedule;
     int score;
     Criteria matchedCriteria;
 };
 
+// Called by `Scheduler::createSchedules` with each new valid schedule as
+// soon as it is found, and the number of schedules found so far.
+typedef std::function<void(const ScoredSchedule&, int)> ScheduleListener;
+
+// The working buffers of a single search. They are sized once and reset
+// between attempts, so generating a schedule does not allocate.
+struct SearchState {
+    CompactSchedule schedule;
+    // Number of matchups still owed between each pair of entities,
+    // indexed by `entity * numEntities + opponent`.
+    std::vector<int> remaining;
+    std::vector<int> unscheduled;
+    std::vector<int> candidates;
+    // Opponent candidates for each depth of the depth-first search,
+    // `numEntities` entries per depth.
+    std::vector<int> candidateStack;
+    // Scratch for opponent ordering, indexed by opponent.
+    std::vector<int> opponentOptions;
+    // Matchings still owed at each week when searching with the matching
+    // table, one block of `MatchingTable::size()` per week after the
+    // first block, which lists every matching.
+    std::vector<int> matchingStack;
+    // Scratch for validation.
+    std::vector<int> matchupCounts;
+    std::vector<int> lastMatchupWeeks;
+    // Objective value of the matchups currently in `schedule`, kept up
+    // to date as matchups are added and removed.
+    int score;
+    // Dead ends hit by the search, and how many it may hit before the
+    // depth-first search gives up.
+    long failures;
+    long failureLimit;
+    std::mt19937 rng;
+};
+
+// Options for the single-threaded search. By default, entities are
+// scheduled in index order, opponents are chosen uniformly at random and
+// dead ends backtrack four weeks.
+struct SearchHeuristics {
+    // Schedule the entity with the fewest possible opponents first.
+    bool minimumRemainingValues;
+    // Prefer opponents that the fewest other entities could play.
+    bool leastConstrainingValue;
+    // Search depth first, restarting after a Luby sequence of dead ends.
+    bool lubyRestarts;
+    // Dead ends per term of the Luby sequence.
+    int restartUnit;
+};
+
+// Counters from the last call to `Scheduler::createSchedules`.
+struct SearchStats {
+    long attempts;
+    long validSchedules;
+    long failures;
+    long restarts;
+    // Lookups in the nogood store, and how many found a known dead end.
+    long nogoodLookups;
+    long nogoodHits;
+    double seconds;
+};
+
 class Scheduler {
 public:
     Scheduler(
@@ -42,42 +120,111 @@ public:
         MatchupConstraints constraints_,
         ScheduleConstraints scheduleConstraints_,
         int weeksBetweenMatchups_,
+        std::string dataPath_,
+        std::string outputPath_,
         std::string logoPath_,
         std::string title_
     );
-    void createSchedules(int n);
-    void printSchedule(Schedule& s);
+    Scheduler(Scheduler&& other);
+    ~Scheduler();
+    std::vector<ScoredSchedule> createSchedules(
+        int n,
+        const std::atomic<bool>* cancelled = nullptr,
+        const ScheduleListener& found = nullptr
+    );
+    void countSchedules(long maxStates, long probes);
+    std::vector<ScoredSchedule> enumerateSchedules(
+        std::string fp,
+        long maxStates,
+        long limit
+    );
+    std::string getOutputFilePath(int rank, const ScoredSchedule& s);
+    void setSearchThreads(int n);
+    void setSearchHeuristics(SearchHeuristics h);
+    void setMatchingEngine(bool enabled);
+    void setTimeBudget(double seconds);
+    void setNogoodCacheSize(int n);
+    void setCriteriaBias(double p);
+    SearchStats getSearchStats();
+    void printSchedule(CompactSchedule& s);
     void generateOutput(ScoredSchedule& s, std::string fp);
     void generateCsv(ScoredSchedule& s, std::string fp);
-    void generatePdf(std::string fp);
+    void generatePdf(ScoredSchedule& s, std::string fp);
 
 private:
+    struct ParallelSearch;
+
     int weeks;
     std::vector<std::string> entities;
-    MatchupConstraints constraints;
-    ScheduleConstraints scheduleConstraints;
+    int numEntities;
+    std::unordered_map<std::string, int> entityIndex;
+    std::vector<int> owedMatchups;
+    CompactSchedule pinnedSchedule;
+    std::vector<bool> pinnedWeeks;
     int weeksBetweenMatchups;
+    int searchThreads;
+    // Worker threads kept between parallel searches.
+    std::unique_ptr<ParallelSearch> parallelSearch;
+    SearchHeuristics heuristics;
+    SearchStats stats;
+    std::unique_ptr<MatchingTable> matchingTable;
+    std::unique_ptr<ScheduleValidator> validator;
+    std::unique_ptr<NogoodStore> nogoods;
+    double timeBudget;
+    std::chrono::steady_clock::time_point startTime;
+    // The cancellation flag of the running `createSchedules` call, if any.
+    const std::atomic<bool>* cancelFlag;
+    // Reading the clock on every dead end would slow the search down, so
+    // the searches check whether to stop once per this many dead ends.
+    static const long stopCheckInterval = 64;
+    Objective objective;
     Criteria scoringCriteria;
-    MatchupConstraints constraintsCheck;
-    Schedule schedule;
+    // Whether any scoring criterion involves an entity in a week, indexed
+    // by `(week - 1) * numEntities + entity`.
+    std::vector<bool> criteriaIndex;
+    double criteriaBias;
+    SearchState state;
+    std::string dataPath;
+    std::string outputPath;
     std::string logoPath;
     std::string title;
     void cleanOutputDirectory(std::string p);
     std::string createScheduleID(int n);
-    void initializeSchedule();
-    void insertScheduleConstraints();
-    void scheduleWeek(int w);
-    std::string getOpponent(int w, std::string e);
-    void alterSchedule(
+    void indexConstraints(MatchupConstraints& c, ScheduleConstraints& sc);
+    void resizeState(SearchState& s);
+    void initializeSchedule(SearchState& s);
+    void insertScheduleConstraints(SearchState& s);
+    void scheduleWeek(SearchState& s, int w);
+    bool addFailure(SearchState& s);
+    int getOpponent(SearchState& s, int w, int e);
+    void placeMatchup(SearchState& s, int w, int e, int o);
+    void removeMatchup(SearchState& s, int w, int e, int o);
+    void alterSchedule(SearchState& s, int w, int e, int o);
+    void cleanup(SearchState& s, int w, int n);
+    bool searchParallel(SearchState& s, const std::atomic<bool>* cancelled);
+    void searchWorker(ParallelSearch& search, int worker);
+    bool searchMatchups(
+        SearchState& s,
         int w,
-        std::string e,
-        std::string o,
-        std::vector<std::string>& ue
+        int d,
+        ParallelSearch* search,
+        int worker
     );
-    void cleanup(int w, int n);
-    bool checkMatchup(int w, std::string e, std::string o);
-    bool validateSchedule();
+    bool searchMatchings(SearchState& s, int w, const int* m, int n);
+    bool canComplete(SearchState& s, int w);
+    bool searchWithRestarts(SearchState& s, const std::atomic<bool>* c);
+    bool isOutOfTime() const;
+    bool isStopped() const;
+    NogoodKey getNogoodKey(const SearchState& s, int w) const;
+    static long luby(long i);
+    int selectEntity(const SearchState& s, int w) const;
+    int countOpponents(const SearchState& s, int w, int e, int x) const;
+    void orderOpponents(SearchState& s, int w, int e, int* c, int n);
+    int preferCriteria(SearchState& s, int w, int e, int* c, int n);
+    bool checkMatchup(const SearchState& s, int w, int e, int o) const;
+    bool validateSchedule(SearchState& s);
+    void printViolation(const Violation& v);
     void loadScoringCriteria(std::string p);
-    ScoredSchedule scoreSchedule(Schedule& s);
+    ScoredSchedule scoreSchedule(const SearchState& s);
     void printScoring(ScoredSchedule& s);
 };
@@ -0,0 +1,136 @@
+// Checks that the schedule search does not allocate once its buffers are
+// warmed up. Every global allocation is counted, so the only allocations
+// `createSchedules` may make per attempt are the ones that store an
+// accepted schedule.
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+
+#include "../scheduler.h"
+
+namespace {
+
+std::atomic<long> allocations(0);
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Returns the allocations made by one call to `createSchedules(n)`.
+long countAllocations(Scheduler& scheduler, int n) {
+    long before = allocations;
+    scheduler.createSchedules(n);
+    return allocations - before;
+}
+
+// `slack` allows for buffers that grow to a peak that varies between runs.
+bool check(const std::string& name, Scheduler& scheduler, long slack = 16) {
+    const int smallRun = 200;
+    const int largeRun = 400;
+
+    scheduler.createSchedules(20);
+    long small = countAllocations(scheduler, smallRun);
+    long smallAttempts = scheduler.getSearchStats().attempts;
+    long large = countAllocations(scheduler, largeRun);
+    long largeAttempts = scheduler.getSearchStats().attempts;
+
+    // Everything outside the attempt loop (output files, logging, the
+    // final sort) costs the same in both runs, so the difference is what
+    // the extra attempts cost. Storing an accepted schedule copies it
+    // once, and growing the result vector adds a few more.
+    long extraAllocations = large - small;
+    long extraAttempts = largeAttempts - smallAttempts;
+    long extraSchedules = largeRun - smallRun;
+    std::cout << name << ": " << extraAllocations << " allocations for "
+              << extraAttempts << " extra attempts and " << extraSchedules
+              << " extra schedules" << std::endl;
+
+    if (extraAllocations > extraSchedules + slack) {
+        std::cerr << name << ": the search allocates per attempt"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    std::vector<std::string> entities;
+    for (int i = 0; i < 8; i++) {
+        entities.push_back("Entity" + std::to_string(i));
+    }
+    MatchupConstraints constraints;
+    for (const auto& entity : entities) {
+        for (const auto& opponent : entities) {
+            if (entity != opponent) {
+                constraints[entity][opponent] = 2;
+            }
+        }
+    }
+
+    std::filesystem::path outputPath =
+        std::filesystem::temp_directory_path() / "scheduler-allocation-test";
+    auto makeScheduler = [&]() {
+        return Scheduler(
+            14,
+            entities,
+            constraints,
+            {},
+            3,
+            "",
+            outputPath.string(),
+            "",
+            "Allocation test"
+        );
+    };
+
+    bool passed = true;
+
+    Scheduler fixedBacktrack = makeScheduler();
+    passed &= check("four-week backtrack", fixedBacktrack);
+
+    Scheduler restarts = makeScheduler();
+    restarts.setSearchHeuristics(SearchHeuristics{true, true, true, 100});
+    passed &= check("Luby restarts", restarts);
+
+    // A store small enough to fill up, so entries are evicted as well.
+    Scheduler nogoods = makeScheduler();
+    nogoods.setSearchHeuristics(SearchHeuristics{true, true, true, 100});
+    nogoods.setNogoodCacheSize(1000);
+    passed &= check("nogood store", nogoods);
+
+    Scheduler matchings = makeScheduler();
+    matchings.setMatchingEngine(true);
+    passed &= check("matching engine", matchings);
+
+    Scheduler parallel = makeScheduler();
+    parallel.setSearchHeuristics(SearchHeuristics{true, true, false, 100});
+    parallel.setSearchThreads(4);
+    passed &= check("parallel search", parallel);
+
+    Scheduler parallelRestarts = makeScheduler();
+    parallelRestarts.setSearchHeuristics(
+        SearchHeuristics{true, true, true, 100}
+    );
+    parallelRestarts.setSearchThreads(4);
+    passed &= check("parallel restarts", parallelRestarts);
+
+    std::filesystem::remove_all(outputPath);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,68 @@
+// Checks that the incremental score deltas used by the search agree with
+// a full evaluation, for random weights and random sequences of placed
+// and removed matchups.
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../objective.h"
+
+int main() {
+    const int weeks = 12;
+    const int numEntities = 8;
+    const int weeksBetweenMatchups = 2;
+    std::mt19937 rng(12345);
+
+    for (int trial = 0; trial < 200; trial++) {
+        Objective objective(weeks, numEntities, weeksBetweenMatchups);
+        for (int i = 0; i < 40; i++) {
+            int entity = rng() % numEntities;
+            int opponent = rng() % numEntities;
+            if (entity != opponent) {
+                objective.addMatchupWeight(
+                    rng() % weeks + 1, entity, opponent, int(rng() % 7) - 3
+                );
+            }
+        }
+        objective.setRematchSpreadWeight(trial % 3);
+
+        std::vector<int> schedule(weeks * numEntities, -1);
+        int score = 0;
+        for (int step = 0; step < 500; step++) {
+            int week = rng() % weeks + 1;
+            int entity = rng() % numEntities;
+            int* matchups = &schedule[(week - 1) * numEntities];
+
+            if (matchups[entity] >= 0) {
+                // Remove the entity's matchup, as the search backtracks.
+                int opponent = matchups[entity];
+                matchups[entity] = -1;
+                matchups[opponent] = -1;
+                score -= objective.getMatchupDelta(
+                    schedule, week, entity, opponent
+                );
+            } else {
+                int opponent = rng() % numEntities;
+                if (opponent == entity || matchups[opponent] >= 0) continue;
+
+                score += objective.getMatchupDelta(
+                    schedule, week, entity, opponent
+                );
+                matchups[entity] = opponent;
+                matchups[opponent] = entity;
+            }
+
+            if (score != objective.evaluate(schedule)) {
+                std::cerr << "Trial " << trial << ", step " << step
+                          << ": incremental score " << score
+                          << " != evaluated score "
+                          << objective.evaluate(schedule) << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,311 @@
+// Checks the schedule validator against a naive oracle that tests each
+// rule directly from its definition, on two million schedules: double
+// round robins and random schedules of random leagues, both with random
+// mutations. A schedule must be valid exactly when the oracle finds no
+// violation, and an invalid schedule must be reported with a violation
+// the oracle also finds.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "../validator.h"
+
+namespace {
+
+struct League {
+    int weeks;
+    int numEntities;
+    int weeksBetweenMatchups;
+    std::vector<int> owedMatchups;
+    std::vector<int> pinnedSchedule;
+};
+
+int bit(ViolationType type) { return 1 << static_cast<int>(type); }
+
+// Returns the set of violated rules as a mask of `bit`s.
+int findViolations(const League& league, const std::vector<int>& schedule) {
+    const int n = league.numEntities;
+    if (schedule.size() != league.weeks * n) {
+        return bit(ViolationType::MissingMatchup);
+    }
+
+    auto opponent = [&](int week, int entity) {
+        return schedule[week * n + entity];
+    };
+    auto isEntity = [&](int entity) { return entity >= 0 && entity < n; };
+
+    int violations = 0;
+    std::vector<int> counts(n * n, 0);
+    for (int week = 0; week < league.weeks; week++) {
+        for (int entity = 0; entity < n; entity++) {
+            int other = opponent(week, entity);
+            int pinned = league.pinnedSchedule[week * n + entity];
+
+            if (pinned >= 0 && pinned != other) {
+                violations |= bit(ViolationType::PinnedWeek);
+            }
+            if (other < 0) {
+                violations |= bit(ViolationType::MissingMatchup);
+                continue;
+            }
+            if (!isEntity(other) || other == entity) {
+                violations |= bit(ViolationType::InvalidOpponent);
+                continue;
+            }
+            if (opponent(week, other) != entity) {
+                violations |= bit(ViolationType::AsymmetricMatchup);
+            }
+
+            ++counts[entity * n + other];
+            int firstWeek = std::max(week - league.weeksBetweenMatchups, 0);
+            for (int earlier = firstWeek; earlier < week; earlier++) {
+                if (opponent(earlier, entity) == other) {
+                    violations |= bit(ViolationType::Spacing);
+                }
+            }
+        }
+    }
+
+    for (int pair = 0; pair < n * n; pair++) {
+        if (counts[pair] > 0 && counts[pair] != league.owedMatchups[pair]) {
+            violations |= bit(ViolationType::MatchupCount);
+        }
+    }
+    return violations;
+}
+
+// A double round robin by the circle method: entity 0 stays put while the
+// others rotate, and the second half repeats the first.
+std::vector<int> roundRobin(int numEntities, std::mt19937& rng) {
+    const int rounds = numEntities - 1;
+    std::vector<int> labels(numEntities);
+    std::iota(labels.begin(), labels.end(), 0);
+    std::shuffle(labels.begin(), labels.end(), rng);
+
+    std::vector<int> schedule(2 * rounds * numEntities);
+    std::vector<int> seats(numEntities);
+    for (int round = 0; round < rounds; round++) {
+        seats[0] = 0;
+        for (int i = 1; i < numEntities; i++) {
+            seats[i] = 1 + (i - 1 + round) % rounds;
+        }
+        for (int i = 0; i < numEntities / 2; i++) {
+            int a = labels[seats[i]];
+            int b = labels[seats[numEntities - 1 - i]];
+            for (int week : {round, round + rounds}) {
+                schedule[week * numEntities + a] = b;
+                schedule[week * numEntities + b] = a;
+            }
+        }
+    }
+    return schedule;
+}
+
+void mutate(
+    std::vector<int>& schedule,
+    const League& league,
+    std::mt19937& rng
+) {
+    const int n = league.numEntities;
+    const int week = rng() % league.weeks;
+    int* matchups = &schedule[week * n];
+
+    switch (rng() % 4) {
+        case 0: {
+            // Any opponent, including missing and out of range ones.
+            matchups[rng() % n] = int(rng() % (n + 2)) - 1;
+            break;
+        }
+        case 1: {
+            // Two entities trade opponents, usually breaking symmetry.
+            std::swap(matchups[rng() % n], matchups[rng() % n]);
+            break;
+        }
+        case 2: {
+            // Two matchups trade opponents, keeping the week symmetric.
+            int a = rng() % n;
+            int b = rng() % n;
+            int c = matchups[a];
+            int d = matchups[b];
+            bool distinct = c >= 0 && c < n && d >= 0 && d < n && a != b &&
+                            a != d && b != c && c != d;
+            if (distinct) {
+                matchups[a] = b;
+                matchups[b] = a;
+                matchups[c] = d;
+                matchups[d] = c;
+            }
+            break;
+        }
+        case 3: {
+            std::swap_ranges(
+                matchups,
+                matchups + n,
+                &schedule[(rng() % league.weeks) * n]
+            );
+            break;
+        }
+    }
+}
+
+// Pins up to two matchups taken from `source`.
+void pinMatchups(
+    League& league,
+    const std::vector<int>& source,
+    std::mt19937& rng
+) {
+    const int n = league.numEntities;
+    league.pinnedSchedule.assign(league.weeks * n, -1);
+    for (int pins = rng() % 3; pins > 0; pins--) {
+        int slot = rng() % source.size();
+        int week = slot / n;
+        int entity = slot % n;
+        int opponent = source[slot];
+        if (opponent >= 0 && opponent < n && opponent != entity) {
+            league.pinnedSchedule[slot] = opponent;
+            league.pinnedSchedule[week * n + opponent] = entity;
+        }
+    }
+}
+
+// A double round robin league that owes every pair two matchups, with
+// the occasional pair owed a different number.
+std::vector<int> roundRobinLeague(League& league, std::mt19937& rng) {
+    league.numEntities = 4 + 2 * (rng() % 3);
+    league.weeks = 2 * (league.numEntities - 1);
+    league.weeksBetweenMatchups = rng() % league.numEntities;
+    const int n = league.numEntities;
+
+    std::vector<int> schedule = roundRobin(n, rng);
+
+    league.owedMatchups.assign(n * n, 2);
+    for (int entity = 0; entity < n; entity++) {
+        league.owedMatchups[entity * n + entity] = 0;
+    }
+    if (rng() % 4 == 0) {
+        int a = rng() % n;
+        int b = rng() % n;
+        league.owedMatchups[a * n + b] = rng() % 4;
+        league.owedMatchups[b * n + a] = league.owedMatchups[a * n + b];
+    }
+
+    // Pins come from this schedule or, sometimes, from another one.
+    pinMatchups(league, rng() % 4 == 0 ? roundRobin(n, rng) : schedule, rng);
+    return schedule;
+}
+
+// A league of any size and length. Most weeks pair the entities in a
+// random order, leaving one out when their number is odd, and the rest
+// are noise. The owed counts are either random or, to make valid
+// schedules likely, the number of times each pair plays.
+std::vector<int> randomLeague(League& league, std::mt19937& rng) {
+    league.numEntities = 2 + rng() % 13;
+    league.weeks = 1 + rng() % 24;
+    league.weeksBetweenMatchups =
+        rng() % 4 == 0 ? rng() % (league.weeks + 1) : rng() % 3;
+    const int n = league.numEntities;
+
+    std::vector<int> schedule(league.weeks * n, -1);
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    for (int week = 0; week < league.weeks; week++) {
+        int* matchups = &schedule[week * n];
+        if (rng() % 8 == 0) {
+            for (int entity = 0; entity < n; entity++) {
+                matchups[entity] = int(rng() % (n + 2)) - 1;
+            }
+            continue;
+        }
+
+        std::shuffle(order.begin(), order.end(), rng);
+        for (int i = 0; i + 1 < n; i += 2) {
+            matchups[order[i]] = order[i + 1];
+            matchups[order[i + 1]] = order[i];
+        }
+    }
+
+    league.owedMatchups.assign(n * n, 0);
+    if (rng() % 2 == 0) {
+        for (int i = 0; i < schedule.size(); i++) {
+            int entity = i % n;
+            int opponent = schedule[i];
+            if (opponent >= 0 && opponent < n && opponent != entity) {
+                ++league.owedMatchups[entity * n + opponent];
+            }
+        }
+    } else {
+        for (int entity = 0; entity < n; entity++) {
+            for (int opponent = entity + 1; opponent < n; opponent++) {
+                int owed = rng() % 4;
+                league.owedMatchups[entity * n + opponent] = owed;
+                league.owedMatchups[opponent * n + entity] = owed;
+            }
+        }
+    }
+
+    pinMatchups(league, schedule, rng);
+    return schedule;
+}
+
+}  // namespace
+
+int main() {
+    const long numTrials = 2000000;
+    std::mt19937 rng(2024);
+    // Valid and invalid schedules from each generator.
+    long numValid[2] = {0, 0};
+    long numInvalid[2] = {0, 0};
+
+    for (long trial = 0; trial < numTrials; trial++) {
+        const int generator = trial % 2;
+        League league;
+        std::vector<int> schedule = generator == 0
+                                        ? roundRobinLeague(league, rng)
+                                        : randomLeague(league, rng);
+
+        for (int mutations = rng() % 4; mutations > 0; mutations--) {
+            mutate(schedule, league, rng);
+        }
+        if (rng() % 100 == 0) {
+            schedule.pop_back();
+        }
+
+        ScheduleValidator validator(
+            league.weeks,
+            league.numEntities,
+            league.weeksBetweenMatchups,
+            league.owedMatchups,
+            league.pinnedSchedule
+        );
+        Violation violation = validator.validate(schedule);
+        int expected = findViolations(league, schedule);
+
+        bool valid = violation.type == ViolationType::None;
+        if (valid != (expected == 0) ||
+            (!valid && !(expected & bit(violation.type)))) {
+            std::cerr << "Trial " << trial << ": the validator reported "
+                      << getViolationName(violation.type)
+                      << ", but the oracle found violations " << expected
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+        (valid ? numValid : numInvalid)[generator]++;
+    }
+
+    const char* names[2] = {"round robin", "random"};
+    for (int generator = 0; generator < 2; generator++) {
+        std::cout << names[generator] << ": " << numValid[generator]
+                  << " valid and " << numInvalid[generator]
+                  << " invalid schedules agreed with the oracle" << std::endl;
+        if (numValid[generator] == 0 || numInvalid[generator] == 0) {
+            std::cerr << "The " << names[generator]
+                      << " trials did not cover both outcomes" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
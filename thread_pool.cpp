@@ -0,0 +1,64 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int numThreads)
+    : nextSequence(0), numRunning(0), stopping(false) {
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+// Finishes the queued tasks before joining the workers.
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(int priority, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(Task{priority, nextSequence++, std::move(task)});
+    }
+    taskAvailable.notify_one();
+}
+
+// Blocks until the queue is empty and no task is running.
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return tasks.empty() && numRunning == 0; });
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] {
+                return stopping || !tasks.empty();
+            });
+            if (tasks.empty()) {
+                return;
+            }
+
+            task = std::move(const_cast<Task&>(tasks.top()).run);
+            tasks.pop();
+            ++numRunning;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --numRunning;
+            if (tasks.empty() && numRunning == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+}
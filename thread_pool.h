@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running queued tasks. Tasks with a higher
+// priority run first; tasks with equal priority run in submission order.
+class ThreadPool {
+public:
+    ThreadPool(int numThreads);
+    ~ThreadPool();
+    void submit(int priority, std::function<void()> task);
+    void wait();
+
+private:
+    struct Task {
+        int priority;
+        long sequence;
+        std::function<void()> run;
+
+        bool operator<(const Task& other) const {
+            if (priority != other.priority) {
+                return priority < other.priority;
+            }
+            return sequence > other.sequence;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    std::priority_queue<Task> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable idle;
+    long nextSequence;
+    int numRunning;
+    bool stopping;
+    void work();
+};
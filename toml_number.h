@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <toml.hpp>
+
+// Reads a number that may be written either as a TOML integer or as a
+// float, such as `600` or `0.5` seconds. `toml::find_or<double>` would
+// silently return `fallback` for an integer.
+inline double findNumberOr(
+    const toml::value& table,
+    const std::string& key,
+    double fallback
+) {
+    if (!table.contains(key)) {
+        return fallback;
+    }
+
+    const toml::value& value = toml::find(table, key);
+    if (value.is_integer()) {
+        return static_cast<double>(value.as_integer());
+    }
+    return toml::get<double>(value);
+}
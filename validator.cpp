@@ -0,0 +1,112 @@
+#include "validator.h"
+
+#include <algorithm>
+
+const char* getViolationName(ViolationType type) {
+    switch (type) {
+        case ViolationType::None:
+            return "valid";
+        case ViolationType::MissingMatchup:
+            return "missing matchup";
+        case ViolationType::InvalidOpponent:
+            return "invalid opponent";
+        case ViolationType::AsymmetricMatchup:
+            return "asymmetric matchup";
+        case ViolationType::PinnedWeek:
+            return "pinned matchup not kept";
+        case ViolationType::Spacing:
+            return "rematch too soon";
+        case ViolationType::MatchupCount:
+            return "wrong number of matchups";
+    }
+    return "unknown";
+}
+
+ScheduleValidator::ScheduleValidator(
+    int weeks_,
+    int numEntities_,
+    int weeksBetweenMatchups_,
+    std::vector<int> owedMatchups_,
+    std::vector<int> pinnedSchedule_
+)
+    : weeks(weeks_),
+      numEntities(numEntities_),
+      weeksBetweenMatchups(weeksBetweenMatchups_),
+      owedMatchups(owedMatchups_),
+      pinnedSchedule(pinnedSchedule_) {}
+
+Violation ScheduleValidator::validate(const std::vector<int>& schedule) const {
+    std::vector<int> matchupCounts;
+    std::vector<int> lastMatchupWeeks;
+    return validate(schedule, matchupCounts, lastMatchupWeeks);
+}
+
+// Validates `schedule`, using the two scratch buffers for per-pair
+// counts and the last week each pair played. The buffers are resized
+// as needed, so reusing them between calls avoids allocating.
+Violation ScheduleValidator::validate(
+    const std::vector<int>& schedule,
+    std::vector<int>& matchupCounts,
+    std::vector<int>& lastMatchupWeeks
+) const {
+    int numPairs = numEntities * numEntities;
+    matchupCounts.assign(numPairs, 0);
+    lastMatchupWeeks.assign(numPairs, -weeks - weeksBetweenMatchups - 1);
+
+    if (schedule.size() != weeks * numEntities) {
+        return Violation{ViolationType::MissingMatchup, 0, -1, -1};
+    }
+
+    for (int week = 1; week <= weeks; week++) {
+        const int* matchups = &schedule[(week - 1) * numEntities];
+        const int* pinned = &pinnedSchedule[(week - 1) * numEntities];
+
+        for (int entity = 0; entity < numEntities; entity++) {
+            int opponent = matchups[entity];
+
+            if (opponent < 0) {
+                return Violation{
+                    ViolationType::MissingMatchup, week, entity, -1
+                };
+            }
+            if (opponent >= numEntities || opponent == entity) {
+                return Violation{
+                    ViolationType::InvalidOpponent, week, entity, opponent
+                };
+            }
+            if (matchups[opponent] != entity) {
+                return Violation{
+                    ViolationType::AsymmetricMatchup, week, entity, opponent
+                };
+            }
+            if (pinned[entity] >= 0 && pinned[entity] != opponent) {
+                return Violation{
+                    ViolationType::PinnedWeek, week, entity, opponent
+                };
+            }
+
+            int pair = entity * numEntities + opponent;
+            if (week - lastMatchupWeeks[pair] <= weeksBetweenMatchups) {
+                return Violation{
+                    ViolationType::Spacing, week, entity, opponent
+                };
+            }
+            lastMatchupWeeks[pair] = week;
+            ++matchupCounts[pair];
+        }
+    }
+
+    for (int pair = 0; pair < numPairs; pair++) {
+        int numMatchups = matchupCounts[pair];
+        if (numMatchups > 0 && numMatchups != owedMatchups[pair]) {
+            return Violation{
+                ViolationType::MatchupCount,
+                0,
+                pair / numEntities,
+                pair % numEntities
+            };
+        }
+    }
+
+    return Violation{ViolationType::None, 0, -1, -1};
+}
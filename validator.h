@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+enum class ViolationType {
+    None,
+    MissingMatchup,
+    InvalidOpponent,
+    AsymmetricMatchup,
+    PinnedWeek,
+    Spacing,
+    MatchupCount,
+};
+
+// Why a schedule is invalid. `week` is 0 for violations that are not
+// tied to one week, and `opponent` is -1 when there is none.
+struct Violation {
+    ViolationType type;
+    int week;
+    int entity;
+    int opponent;
+};
+
+const char* getViolationName(ViolationType type);
+
+// Checks compact schedules (see `CompactSchedule`) against the league's
+// constraints in a single pass over the weeks, without building any maps.
+// A schedule is valid when:
+// - every entity plays another entity every week, and both agree on it,
+// - every pinned matchup is kept,
+// - no pair plays twice within `weeksBetweenMatchups` weeks,
+// - every pair plays either not at all or exactly its owed number of
+//   times.
+class ScheduleValidator {
+public:
+    ScheduleValidator(
+        int weeks_,
+        int numEntities_,
+        int weeksBetweenMatchups_,
+        std::vector<int> owedMatchups_,
+        std::vector<int> pinnedSchedule_
+    );
+    Violation validate(const std::vector<int>& schedule) const;
+    Violation validate(
+        const std::vector<int>& schedule,
+        std::vector<int>& matchupCounts,
+        std::vector<int>& lastMatchupWeeks
+    ) const;
+
+private:
+    int weeks;
+    int numEntities;
+    int weeksBetweenMatchups;
+    std::vector<int> owedMatchups;
+    std::vector<int> pinnedSchedule;
+};
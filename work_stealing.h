@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One deque of tasks per worker. A worker pushes and pops at the back of its
+// own deque, so it keeps working depth first on the subproblems it created.
+// A worker whose deque is empty steals from the front of another deque,
+// taking the oldest and usually largest subproblem. Deques keep their
+// capacity when they empty, and `reserve` sizes them up front, so pushing
+// does not allocate.
+template <typename T>
+class WorkStealingQueues {
+public:
+    WorkStealingQueues(int numWorkers) {
+        for (int i = 0; i < numWorkers; i++) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+    }
+
+    // Lets every deque hold `n` tasks without growing.
+    void reserve(size_t n) {
+        for (auto& queue : queues) {
+            queue->tasks.reserve(n);
+        }
+    }
+
+    void push(int worker, T task) {
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+        queues[worker]->tasks.push_back(std::move(task));
+    }
+
+    bool pop(int worker, T& task) {
+        {
+            Queue& own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.front < own.tasks.size()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                own.compact();
+                return true;
+            }
+        }
+
+        for (int i = 1; i < queues.size(); i++) {
+            Queue& victim = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.front < victim.tasks.size()) {
+                task = std::move(victim.tasks[victim.front++]);
+                victim.compact();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    // Tasks before `front` have been stolen.
+    struct Queue {
+        std::mutex mutex;
+        std::vector<T> tasks;
+        size_t front = 0;
+
+        void compact() {
+            if (front == tasks.size()) {
+                tasks.clear();
+                front = 0;
+            } else if (front * 2 > tasks.size()) {
+                tasks.erase(tasks.begin(), tasks.begin() + front);
+                front = 0;
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+};